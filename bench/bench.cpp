@@ -0,0 +1,92 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+// Counting replacements for the global allocation functions. Sizes are
+// taken from the allocator rather than the caller, so unsized deletes
+// balance out
+namespace
+{
+    std::atomic<std::size_t> _allocations(0);
+    std::atomic<std::size_t> _liveBytes(0);
+
+    void *allocate(std::size_t size, std::size_t alignment)
+    {
+        if (!size) size = 1;
+        void *p = alignment <= alignof(std::max_align_t) ?
+            std::malloc(size) :
+            std::aligned_alloc(alignment, (size + alignment - 1) / alignment *
+                                          alignment);
+        if (!p) throw std::bad_alloc();
+
+        _allocations.fetch_add(1, std::memory_order_relaxed);
+        _liveBytes.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+        return p;
+    }
+
+    void release(void *p) noexcept
+    {
+        if (!p) return;
+        _liveBytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+        std::free(p);
+    }
+}
+
+std::size_t Bench::getAllocations()
+{
+    return _allocations.load();
+}
+
+std::size_t Bench::getLiveBytes()
+{
+    return _liveBytes.load();
+}
+
+void *operator new(std::size_t size)
+{
+    return allocate(size, 0);
+}
+
+void *operator new[](std::size_t size)
+{
+    return allocate(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *p) noexcept { release(p); }
+void operator delete[](void *p) noexcept { release(p); }
+void operator delete(void *p, std::size_t) noexcept { release(p); }
+void operator delete[](void *p, std::size_t) noexcept { release(p); }
+void operator delete(void *p, std::align_val_t) noexcept { release(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { release(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { release(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { release(p); }
@@ -0,0 +1,129 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_BENCH_BENCH_H__
+#define __OGRE_BENCH_BENCH_H__
+
+#include "defines.h"
+
+#include <algorithm>
+#include <boost/log/core.hpp>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "entity.h"
+
+// Bits and pieces shared by the benchmark programs. Each one prints a table
+// of results; build in Release for numbers worth comparing
+namespace Bench
+{
+    // Every call to operator new since the program started, and the bytes
+    // it's handed out that haven't been deleted yet, see bench.cpp
+    std::size_t getAllocations();
+    std::size_t getLiveBytes();
+
+    inline void init()
+    {
+        boost::log::core::get()->set_logging_enabled(false);
+    }
+
+    // Best of several runs of fn(), in seconds. The best run is the one
+    // least disturbed by whatever else the machine was doing
+    template <class F>
+    double time(F fn, unsigned runs = 5)
+    {
+        typedef std::chrono::steady_clock Clock;
+
+        double best = 0;
+        for (unsigned run = 0; run < runs; run++)
+        {
+            auto start = Clock::now();
+            fn();
+            double seconds =
+                std::chrono::duration<double>(Clock::now() - start).count();
+            if (!run || seconds < best) best = seconds;
+        }
+        return best;
+    }
+
+    // As above, but fn(subject) gets a fresh T for each run, made before the
+    // clock starts and torn down after it stops
+    template <class T, class F>
+    double timeWith(F fn, unsigned runs = 5)
+    {
+        typedef std::chrono::steady_clock Clock;
+
+        double best = 0;
+        for (unsigned run = 0; run < runs; run++)
+        {
+            T subject;
+            auto start = Clock::now();
+            fn(subject);
+            double seconds =
+                std::chrono::duration<double>(Clock::now() - start).count();
+            if (!run || seconds < best) best = seconds;
+        }
+        return best;
+    }
+
+    inline void report(const std::string &what, double value,
+                       const std::string &unit)
+    {
+        std::cout << std::left << std::setw(56) << what << std::right
+                  << std::setw(12) << std::fixed << std::setprecision(1)
+                  << value << " " << unit << std::endl;
+    }
+
+    // Same order every run, so runs can be compared
+    template <class T>
+    inline void shuffle(std::vector<T> &values)
+    {
+        std::shuffle(values.begin(), values.end(), std::mt19937(12345));
+    }
+
+    // Keeps the optimiser from throwing away a result
+    template <class T>
+    inline void use(const T &value)
+    {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+
+    // Components of a few distinct types, all the same size, created the
+    // way real ones are
+    template <int N>
+    struct Data : Components::Specific<Data<N>>
+    {
+        float value[4];
+
+        Data(Entity::ID parent) :
+            Components::Specific<Data<N>>(parent), value{ 1, 2, 3, 4 } {}
+
+        static Data *create(Entity::ID parent)
+        {
+            auto ptr = new Data(parent);
+            Events::Dispatcher::raise<Events::ComponentCreated>(ptr);
+            return ptr;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,279 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "entitymanager.h"
+
+using Bench::Data;
+
+namespace
+{
+    constexpr std::size_t COUNT = 100000;
+
+    // What each entity costs, counting the manager's own tables and the
+    // archetype chunks and component pools it's spread over
+    void memoryPerEntity()
+    {
+        EntityManager manager;
+        std::vector<Entity::ID> ids;
+        ids.reserve(COUNT);
+
+        auto base = Bench::getLiveBytes();
+        for (std::size_t i = 0; i < COUNT; i++)
+        {
+            ids.push_back(manager.createEntity());
+        }
+        Bench::report("memory per entity, no components",
+                      double(Bench::getLiveBytes() - base) / COUNT, "bytes");
+
+        for (auto id : ids) Data<0>::create(id);
+        Bench::report("memory per entity, one 16-byte component",
+                      double(Bench::getLiveBytes() - base) / COUNT, "bytes");
+    }
+
+    // Trips to the general heap per entity, once the manager's had a
+    // chance to warm up. Anything that comes out of a pool that already has
+    // room doesn't count
+    void allocations()
+    {
+        EntityManager manager;
+        std::vector<Entity::ID> ids;
+        ids.reserve(2 * COUNT);
+        for (std::size_t i = 0; i < COUNT; i++)
+        {
+            ids.push_back(manager.createEntity());
+            Data<0>::create(ids.back());
+        }
+        for (auto id : ids) manager.destroyEntity(id);
+        ids.clear();
+
+        auto before = Bench::getAllocations();
+        for (std::size_t i = 0; i < COUNT; i++)
+        {
+            ids.push_back(manager.createEntity());
+        }
+        Bench::report("allocations per createEntity",
+                      double(Bench::getAllocations() - before) / COUNT, "");
+
+        before = Bench::getAllocations();
+        for (auto id : ids) Data<0>::create(id);
+        Bench::report("allocations per component",
+                      double(Bench::getAllocations() - before) / COUNT, "");
+
+        before = Bench::getAllocations();
+        for (auto id : ids) manager.destroyEntity(id);
+        Bench::report("allocations per destroyEntity",
+                      double(Bench::getAllocations() - before) / COUNT, "");
+    }
+
+    // Looking entities up by ID, in creation order and scattered
+    void lookup()
+    {
+        EntityManager manager;
+        std::vector<Entity::ID> ids;
+        ids.reserve(COUNT);
+        for (std::size_t i = 0; i < COUNT; i++)
+        {
+            ids.push_back(manager.createEntity());
+            Data<0>::create(ids.back());
+        }
+
+        auto seconds = Bench::time([&]()
+        {
+            std::size_t alive = 0;
+            for (auto id : ids) alive += manager.isAlive(id);
+            Bench::use(alive);
+        });
+        Bench::report("isAlive, in order", seconds * 1e9 / COUNT, "ns");
+
+        std::vector<Entity::ID> shuffled(ids);
+        Bench::shuffle(shuffled);
+
+        seconds = Bench::time([&]()
+        {
+            std::size_t alive = 0;
+            for (auto id : shuffled) alive += manager.isAlive(id);
+            Bench::use(alive);
+        });
+        Bench::report("isAlive, scattered", seconds * 1e9 / COUNT, "ns");
+
+        seconds = Bench::time([&]()
+        {
+            float sum = 0;
+            for (auto id : shuffled) sum += manager.tryGetComponent<Data<0>>(id)->value[0];
+            Bench::use(sum);
+        });
+        Bench::report("tryGetComponent, scattered", seconds * 1e9 / COUNT, "ns");
+    }
+
+    // Hits and misses through tryGetComponent, and through getComponent
+    // and a catch, which is how a miss had to be handled before
+    void hitsAndMisses()
+    {
+        EntityManager manager;
+        auto ids = manager.createEntities(COUNT);
+        for (auto id : ids) Data<0>::create(id);
+
+        auto seconds = Bench::time([&]()
+        {
+            std::size_t found = 0;
+            for (auto id : ids) found += manager.tryGetComponent<Data<0>>(id) != nullptr;
+            Bench::use(found);
+        });
+        Bench::report("tryGetComponent, hit", seconds * 1e9 / COUNT, "ns");
+
+        seconds = Bench::time([&]()
+        {
+            std::size_t found = 0;
+            for (auto id : ids) found += manager.tryGetComponent<Data<1>>(id) != nullptr;
+            Bench::use(found);
+        });
+        Bench::report("tryGetComponent, miss", seconds * 1e9 / COUNT, "ns");
+
+        seconds = Bench::time([&]()
+        {
+            std::size_t found = 0;
+            for (auto id : ids) found += manager.getComponent<Data<0>>(id) != nullptr;
+            Bench::use(found);
+        });
+        Bench::report("getComponent, hit", seconds * 1e9 / COUNT, "ns");
+
+        // Misses are slow enough that a tenth of them will do
+        seconds = Bench::time([&]()
+        {
+            std::size_t found = 0;
+            for (std::size_t i = 0; i < COUNT / 10; i++)
+            {
+                try
+                {
+                    found += manager.getComponent<Data<1>>(ids[i]) != nullptr;
+                }
+                catch (const Exceptions::NoSuchComponent &) {}
+            }
+            Bench::use(found);
+        });
+        Bench::report("getComponent and catch, miss",
+                      seconds * 1e9 / (COUNT / 10), "ns");
+    }
+
+    // Spawning a batch one at a time and all at once, then clearing it out
+    // the same ways
+    void spawn()
+    {
+        auto seconds = Bench::timeWith<EntityManager>([](EntityManager &manager)
+        {
+            for (std::size_t i = 0; i < COUNT; i++) manager.createEntity();
+        });
+        Bench::report("createEntity x100k", seconds * 1e3, "ms");
+
+        seconds = Bench::timeWith<EntityManager>([](EntityManager &manager)
+        {
+            Bench::use(manager.createEntities(COUNT));
+        });
+        Bench::report("createEntities(100k)", seconds * 1e3, "ms");
+
+        struct Spawned
+        {
+            EntityManager manager;
+            std::vector<Entity::ID> ids;
+
+            Spawned() : ids(manager.createEntities(COUNT))
+            {
+                for (auto id : ids) Data<0>::create(id);
+            }
+        };
+
+        seconds = Bench::timeWith<Spawned>([](Spawned &spawned)
+        {
+            for (auto id : spawned.ids) spawned.manager.destroyEntity(id);
+        });
+        Bench::report("destroyEntity x100k, one component each",
+                      seconds * 1e3, "ms");
+
+        seconds = Bench::timeWith<Spawned>([](Spawned &spawned)
+        {
+            spawned.manager.destroyEntities(spawned.ids);
+        });
+        Bench::report("destroyEntities(100k), one component each",
+                      seconds * 1e3, "ms");
+    }
+
+    // What debug names cost, named entities against unnamed ones. Only
+    // means anything when compared across a build with _DEBUG_NAMES and
+    // one without, since names compile to nothing in the latter
+    void names()
+    {
+#ifdef _DEBUG_NAMES
+        Bench::report("debug names compiled in", 1, "");
+#else
+        Bench::report("debug names compiled in", 0, "");
+#endif
+        Bench::report("sizeof one 16-byte component", sizeof(Data<0>), "bytes");
+
+        // A bounded set of names, which is what the intern table is for
+        std::vector<std::string> names;
+        for (int i = 0; i < 16; i++) names.push_back("enemy " + std::to_string(i));
+
+        for (bool named : { false, true })
+        {
+            std::string label = named ? ", named" : ", unnamed";
+
+            {
+                EntityManager manager;
+                auto base = Bench::getLiveBytes();
+                for (std::size_t i = 0; i < COUNT; i++)
+                {
+                    auto id = named ? manager.createEntity(names[i % names.size()]) :
+                                      manager.createEntity();
+                    Data<0>::create(id);
+                }
+                Bench::report("memory per entity, one component" + label,
+                              double(Bench::getLiveBytes() - base) / COUNT, "bytes");
+            }
+
+            auto seconds = Bench::timeWith<EntityManager>(
+                [&names, named](EntityManager &manager)
+            {
+                for (std::size_t i = 0; i < COUNT; i++)
+                {
+                    auto id = named ? manager.createEntity(names[i % names.size()]) :
+                                      manager.createEntity();
+                    Data<0>::create(id);
+                }
+            });
+            Bench::report("createEntity and component x100k" + label,
+                          seconds * 1e3, "ms");
+        }
+    }
+}
+
+int main()
+{
+    Bench::init();
+
+    memoryPerEntity();
+    allocations();
+    lookup();
+    hitsAndMisses();
+    spawn();
+    names();
+
+    return 0;
+}
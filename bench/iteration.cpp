@@ -0,0 +1,83 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "bench.h"
+#include "entitymanager.h"
+
+using Bench::Data;
+
+namespace
+{
+    // Sums a field from each of the components Data<Ns>... over count
+    // entities that have all of them, with each() and then by looking every
+    // component up by ID the way systems did before there were queries
+    template <int... Ns>
+    void iterate(std::size_t count)
+    {
+        EntityManager manager;
+        auto ids = manager.createEntities(count);
+        for (auto id : ids)
+        {
+            (Data<Ns>::create(id), ...);
+        }
+
+        std::ostringstream ss;
+        ss << sizeof...(Ns) << " type" << (sizeof...(Ns) > 1 ? "s" : "")
+           << ", " << count << " entities";
+        auto what = ss.str();
+
+        auto seconds = Bench::time([&manager]()
+        {
+            float sum = 0;
+            manager.each<Data<Ns>...>(
+                [&sum](Entity::ID, Data<Ns> &... data)
+                    { sum += (data.value[0] + ...); });
+            Bench::use(sum);
+        });
+        Bench::report("each, " + what, seconds * 1e9 / count, "ns/entity");
+
+        seconds = Bench::time([&manager, &ids]()
+        {
+            float sum = 0;
+            for (auto id : ids)
+            {
+                sum += (manager.tryGetComponent<Data<Ns>>(id)->value[0] + ...);
+            }
+            Bench::use(sum);
+        });
+        Bench::report("tryGetComponent, " + what, seconds * 1e9 / count,
+                      "ns/entity");
+    }
+}
+
+int main()
+{
+    Bench::init();
+
+    for (std::size_t count : { 10000, 100000, 1000000 })
+    {
+        iterate<0>(count);
+        iterate<0, 1>(count);
+        iterate<0, 1, 2, 3>(count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "bench.h"
+#include "entitymanager.h"
+#include "jobsystem.h"
+#include "scheduler.h"
+
+using Bench::Data;
+
+namespace
+{
+    constexpr std::size_t ENTITIES = 20000;
+    constexpr unsigned FRAMES = 20;
+
+    std::string label(const std::string &what, unsigned threads)
+    {
+        std::ostringstream ss;
+        ss << what << ", " << threads << " thread" << (threads > 1 ? "s" : "");
+        return ss.str();
+    }
+
+    // Integrates the values of one component type a few times over. Reads
+    // the type it integrates from and writes the one it integrates into
+    template <int From, int To>
+    class Integrate : public System
+    {
+    public:
+        Integrate(EntityManager &manager) :
+            System("Integrate"), _manager(manager)
+        {
+            reads<Data<From>>();
+            writes<Data<To>>();
+        }
+
+        void update(float dt) override
+        {
+            for (int pass = 0; pass < 8; pass++)
+            {
+                _manager.each<Data<From>, Data<To>>(
+                    [dt](Entity::ID, Data<From> &from, Data<To> &to)
+                    {
+                        for (int i = 0; i < 4; i++) to.value[i] += from.value[i] * dt;
+                    });
+            }
+        }
+
+    private:
+        EntityManager &_manager;
+    };
+
+    template <int... Ns>
+    void populate(EntityManager &manager, std::integer_sequence<int, Ns...>)
+    {
+        for (auto id : manager.createEntities(ENTITIES))
+        {
+            (Data<Ns>::create(id), ...);
+        }
+    }
+
+    // Eight systems that touch disjoint pairs of types and can all run at
+    // once, and eight that all write the same type and have to take turns.
+    // Time per frame at each thread count
+    void scheduler()
+    {
+        EntityManager manager;
+        populate(manager, std::make_integer_sequence<int, 16>());
+
+        for (unsigned threads : { 1, 2, 4, 8 })
+        {
+            JobSystem jobs(threads);
+
+            Scheduler independent(jobs);
+            independent.add<Integrate<0, 1>>(manager);
+            independent.add<Integrate<2, 3>>(manager);
+            independent.add<Integrate<4, 5>>(manager);
+            independent.add<Integrate<6, 7>>(manager);
+            independent.add<Integrate<8, 9>>(manager);
+            independent.add<Integrate<10, 11>>(manager);
+            independent.add<Integrate<12, 13>>(manager);
+            independent.add<Integrate<14, 15>>(manager);
+
+            auto seconds = Bench::time([&independent]()
+            {
+                for (unsigned frame = 0; frame < FRAMES; frame++)
+                {
+                    independent.update(1.0f / 60);
+                }
+            }, 3);
+            Bench::report(label("8 independent systems", threads),
+                          seconds * 1e3 / FRAMES, "ms/frame");
+
+            Scheduler chained(jobs);
+            chained.add<Integrate<1, 0>>(manager);
+            chained.add<Integrate<2, 0>>(manager);
+            chained.add<Integrate<3, 0>>(manager);
+            chained.add<Integrate<4, 0>>(manager);
+            chained.add<Integrate<5, 0>>(manager);
+            chained.add<Integrate<6, 0>>(manager);
+            chained.add<Integrate<7, 0>>(manager);
+            chained.add<Integrate<8, 0>>(manager);
+
+            seconds = Bench::time([&chained]()
+            {
+                for (unsigned frame = 0; frame < FRAMES; frame++)
+                {
+                    chained.update(1.0f / 60);
+                }
+            }, 3);
+            Bench::report(label("8 systems writing one type", threads),
+                          seconds * 1e3 / FRAMES, "ms/frame");
+        }
+    }
+
+    // What a job costs on its own, and what parallelFor() adds over a plain
+    // loop at a few grain sizes
+    void overhead()
+    {
+        constexpr std::size_t JOBS = 100000;
+        constexpr std::size_t COUNT = 1 << 20;
+
+        std::vector<float> values(COUNT, 1.0f);
+        auto serial = Bench::time([&values]()
+        {
+            for (auto &value : values) value = value * 0.5f + 1.0f;
+        });
+        Bench::report("plain loop, 1M floats", serial * 1e6, "us");
+
+        for (unsigned threads : { 1, 4 })
+        {
+            JobSystem jobs(threads);
+
+            // In batches small enough to stay within the job pool
+            auto seconds = Bench::time([&jobs]()
+            {
+                for (std::size_t batch = 0; batch < JOBS; batch += 1000)
+                {
+                    JobCounter counter;
+                    for (std::size_t i = 0; i < 1000; i++)
+                    {
+                        jobs.run([] {}, &counter);
+                    }
+                    jobs.wait(counter);
+                }
+            });
+            Bench::report(label("empty job, 1000 at a time", threads),
+                          seconds * 1e9 / JOBS, "ns/job");
+
+            // All at once, which runs the job pool dry
+            seconds = Bench::time([&jobs]()
+            {
+                JobCounter counter;
+                for (std::size_t i = 0; i < JOBS; i++)
+                {
+                    jobs.run([] {}, &counter);
+                }
+                jobs.wait(counter);
+            });
+            Bench::report(label("empty job, 100k at once", threads),
+                          seconds * 1e9 / JOBS, "ns/job");
+
+            for (std::size_t grain : { 0, 65536, 4096, 256 })
+            {
+                seconds = Bench::time([&jobs, &values, grain]()
+                {
+                    jobs.parallelFor(0, values.size(), grain,
+                        [&values](std::size_t first, std::size_t last)
+                        {
+                            for (auto i = first; i < last; i++)
+                            {
+                                values[i] = values[i] * 0.5f + 1.0f;
+                            }
+                        });
+                });
+
+                std::ostringstream ss;
+                ss << "parallelFor, 1M floats, grain ";
+                if (grain) ss << grain; else ss << "auto";
+                Bench::report(label(ss.str(), threads), seconds * 1e6, "us");
+            }
+
+            // Jobs come out of a pool, so a piece shouldn't need the heap
+            constexpr std::size_t PIECES = 256;
+            auto before = Bench::getAllocations();
+            jobs.parallelFor(0, values.size(), values.size() / PIECES,
+                [&values](std::size_t first, std::size_t) { values[first] = 0; });
+            Bench::report(label("parallelFor, allocations per piece", threads),
+                          double(Bench::getAllocations() - before) / PIECES, "");
+        }
+    }
+}
+
+int main()
+{
+    Bench::init();
+
+    std::cout << boost::thread::hardware_concurrency()
+              << " hardware threads" << std::endl;
+    scheduler();
+    overhead();
+
+    return 0;
+}
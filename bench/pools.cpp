@@ -0,0 +1,161 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "bench.h"
+#include "concurrentpool.h"
+#include "pool.h"
+
+namespace
+{
+    struct Particle
+    {
+        float x, y, z;
+        int life;
+    };
+
+    constexpr unsigned CAPACITY = 1 << 16;
+    constexpr unsigned OPS_PER_THREAD = 1 << 20;
+    constexpr unsigned BATCH = 16;
+
+    // Each thread allocates a batch of objects and releases them again, over
+    // and over. Returns the wall clock time per allocate and release pair
+    template <class Allocate, class Release>
+    double churn(unsigned threads, Allocate allocate, Release release)
+    {
+        return Bench::time([&]()
+        {
+            std::vector<boost::thread> workers;
+            for (unsigned t = 0; t < threads; t++)
+            {
+                workers.emplace_back([&]()
+                {
+                    Particle *batch[BATCH];
+                    for (unsigned op = 0; op < OPS_PER_THREAD; op += BATCH)
+                    {
+                        for (auto &object : batch) object = allocate();
+                        for (auto object : batch) release(object);
+                    }
+                });
+            }
+            for (auto &worker : workers) worker.join();
+        }, 3) * 1e9 / (double(threads) * OPS_PER_THREAD);
+    }
+
+    std::string label(const char *pool, unsigned threads)
+    {
+        std::ostringstream ss;
+        ss << pool << ", " << threads << " thread" << (threads > 1 ? "s" : "");
+        return ss.str();
+    }
+
+    // A plain Pool behind a mutex, which is what sharing one took before
+    // ConcurrentPool, against ConcurrentPool's per-thread magazines
+    void contention()
+    {
+        {
+            Pool<Particle, CAPACITY> pool;
+            Bench::report("Pool, unlocked, 1 thread",
+                          churn(1, [&]() { return pool.allocate(); },
+                                   [&](Particle *p) { pool.release(p); }),
+                          "ns/op");
+        }
+
+        for (unsigned threads : { 1, 2, 4, 8 })
+        {
+            Pool<Particle, CAPACITY> pool;
+            boost::mutex mutex;
+            auto seconds = churn(threads,
+                [&]()
+                {
+                    boost::lock_guard<boost::mutex> lock(mutex);
+                    return pool.allocate();
+                },
+                [&](Particle *p)
+                {
+                    boost::lock_guard<boost::mutex> lock(mutex);
+                    pool.release(p);
+                });
+            Bench::report(label("Pool and mutex", threads), seconds, "ns/op");
+        }
+
+        for (unsigned threads : { 1, 2, 4, 8 })
+        {
+            ConcurrentPool<Particle, CAPACITY> pool;
+            auto seconds = churn(threads,
+                [&]() { return pool.allocate(); },
+                [&](Particle *p) { pool.release(p); });
+            Bench::report(label("ConcurrentPool", threads), seconds, "ns/op");
+        }
+    }
+
+    constexpr unsigned LAYOUT_CAPACITY = 1 << 20;
+
+    // Walks a full pool of particles in address order with forEach(), then
+    // in a scattered order through pointers, as systems chasing references
+    // would. Pools are big, so they go on the heap
+    template <unsigned Options>
+    void layout(const char *name)
+    {
+        std::unique_ptr<Pool<Particle, LAYOUT_CAPACITY, Options>> pool(
+            new Pool<Particle, LAYOUT_CAPACITY, Options>());
+
+        std::vector<Particle *> objects;
+        objects.reserve(LAYOUT_CAPACITY);
+        for (unsigned i = 0; i < LAYOUT_CAPACITY; i++)
+        {
+            objects.push_back(new (pool->allocate()) Particle{ 0, 0, 0, int(i) });
+        }
+
+        auto seconds = Bench::time([&pool]()
+        {
+            pool->forEach([](Particle &p) { p.x += p.life; });
+        });
+        Bench::report(std::string(name) + ", forEach",
+                      seconds * 1e9 / LAYOUT_CAPACITY, "ns/object");
+
+        Bench::shuffle(objects);
+        seconds = Bench::time([&objects]()
+        {
+            for (auto p : objects) p->y += p->life;
+        });
+        Bench::report(std::string(name) + ", scattered",
+                      seconds * 1e9 / LAYOUT_CAPACITY, "ns/object");
+
+        for (auto p : objects) pool->release(p);
+    }
+}
+
+int main()
+{
+    Bench::init();
+
+    std::cout << boost::thread::hardware_concurrency()
+              << " hardware threads" << std::endl;
+    contention();
+
+    layout<PoolOptions::Default>("1M 16-byte objects, default slots");
+    layout<PoolOptions::CacheAligned>("1M 16-byte objects, cache-aligned slots");
+    layout<PoolOptions::HugePages>("1M 16-byte objects, huge pages");
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/filesystem.hpp>
+
+#include "bench.h"
+#include "entitymanager.h"
+#include "snapshot.h"
+
+using Bench::Data;
+
+template <int N>
+struct SnapshotTraits<Data<N>>
+{
+    static constexpr std::uint32_t VERSION = 1;
+
+    static void save(const Data<N> &data, SnapshotWriter &out)
+    {
+        for (auto value : data.value) out.write(value);
+    }
+
+    static Data<N> *load(Entity::ID parent, SnapshotReader &in)
+    {
+        auto data = new Data<N>(parent);
+        for (auto &value : data->value) value = in.read<float>();
+        return data;
+    }
+};
+
+namespace
+{
+    constexpr std::size_t COUNT = 100000;
+
+    // Where the world is saved. A function rather than an argument so
+    // subjects made by Bench::timeWith can get at it too
+    const std::string &getPath()
+    {
+        static const std::string path =
+            (boost::filesystem::temp_directory_path() /
+             boost::filesystem::unique_path("bench-%%%%-%%%%.bin")).string();
+        return path;
+    }
+
+    // Two components on every entity, as a level's constructor would
+    // make them
+    void populate(EntityManager &manager)
+    {
+        for (std::size_t i = 0; i < COUNT; i++)
+        {
+            auto id = manager.createEntity();
+            Data<0>::create(id);
+            Data<1>::create(id);
+        }
+    }
+
+    // Bringing a 100k-entity world up from a snapshot against building it
+    // in code, one entity at a time and in a batch
+    void load()
+    {
+        auto &path = getPath();
+        {
+            EntityManager manager;
+            populate(manager);
+
+            auto seconds = Bench::time([&manager, &path]()
+            {
+                Snapshot::save(manager, path);
+            });
+            Bench::report("save 100k entities, two components each",
+                          seconds * 1e3, "ms");
+            Bench::report("snapshot size per entity",
+                          double(boost::filesystem::file_size(path)) / COUNT,
+                          "bytes");
+        }
+
+        auto seconds = Bench::timeWith<EntityManager>(populate);
+        Bench::report("create in code, one at a time", seconds * 1e3, "ms");
+
+        seconds = Bench::timeWith<EntityManager>([](EntityManager &manager)
+        {
+            for (auto id : manager.createEntities(COUNT))
+            {
+                Data<0>::create(id);
+                Data<1>::create(id);
+            }
+        });
+        Bench::report("create in code, createEntities", seconds * 1e3, "ms");
+
+        seconds = Bench::timeWith<EntityManager>([&path](EntityManager &manager)
+        {
+            Bench::use(Snapshot::load(manager, path));
+        });
+        Bench::report("load from snapshot", seconds * 1e3, "ms");
+
+        // Every entity already known, so each has its components replaced
+        struct Loaded
+        {
+            EntityManager manager;
+            Snapshot::Relocations relocations;
+
+            Loaded() { Snapshot::load(manager, getPath(), relocations); }
+        };
+
+        seconds = Bench::timeWith<Loaded>([&path](Loaded &loaded)
+        {
+            Bench::use(Snapshot::load(loaded.manager, path, loaded.relocations));
+        });
+        Bench::report("load over the same entities", seconds * 1e3, "ms");
+    }
+}
+
+int main()
+{
+    Bench::init();
+
+    Snapshot::registerType<Data<0>>();
+    Snapshot::registerType<Data<1>>();
+
+    load();
+    boost::filesystem::remove(getPath());
+
+    return 0;
+}
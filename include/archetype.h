@@ -0,0 +1,220 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_ARCHETYPE_H__
+#define __OGRE_ARCHETYPE_H__
+
+#include "defines.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "entity.h"
+#include "stringable.h"
+#include "typeids.h"
+
+// Storage for every entity that has exactly the same set of component types.
+//
+// Rows are packed densely into fixed-size chunks. Each chunk holds an array
+// of entity IDs followed by one array per component type, so walking one
+// type's column touches nothing but that type's pointers, and then one
+// array of change versions per component type. Removing a row moves the
+// archetype's last row into the hole.
+//
+// Components themselves are polymorphic and own OGRE objects, so columns
+// hold pointers to them rather than the components by value. Each type's
+// components come out of a pool of their own (see Components::Specific),
+// so the pointers in a column lead into one packed block of memory
+class Archetype : public Stringable
+{
+public:
+    typedef Entity::ID ID;
+
+    // Dense component type ID, see TypeIds
+    typedef unsigned TypeId;
+
+    // Component type IDs, sorted
+    typedef std::vector<TypeId> Signature;
+
+    // When a component last changed, see EntityManager::getVersion
+    typedef std::uint32_t Version;
+
+    static constexpr std::size_t CHUNK_SIZE = 16 * 1024;
+    static constexpr unsigned NO_COLUMN = ~0u;
+
+    Archetype(const Signature &signature);
+    ~Archetype();
+
+    Archetype(const Archetype &) = delete;
+    Archetype &operator=(const Archetype &) = delete;
+
+    inline const Signature &getSignature() const { return _signature; }
+    inline std::size_t getSize() const { return _size; }
+    inline unsigned getChunkCapacity() const { return _chunkCapacity; }
+    // Rows that fit in the chunks held, used or not
+    inline std::size_t getCapacity() const
+    {
+        return _chunks.size() * _chunkCapacity;
+    }
+    // Chunks in use, there may be more reserved after them
+    inline unsigned getChunkCount() const
+    {
+        return static_cast<unsigned>((_size + _chunkCapacity - 1) /
+                                     _chunkCapacity);
+    }
+
+    // Column holding the given component type, or NO_COLUMN
+    inline unsigned getColumn(TypeId type) const
+    {
+        return type < _columns.size() ? _columns[type] : NO_COLUMN;
+    }
+
+    inline bool has(TypeId type) const
+    {
+        return getColumn(type) != NO_COLUMN;
+    }
+
+    // Appends a row for the entity with every component null and changed at
+    // the given version, returning the new row
+    unsigned addRow(ID id, Version version);
+
+    // Allocates enough chunks up front to hold this many rows in total.
+    // They're kept until shrink(), however many rows are removed
+    void reserve(std::size_t rows);
+
+    // Removes a row by moving the last row into its place. Returns true and
+    // sets moved to that row's entity if one had to be moved. One empty
+    // chunk is kept past the last row so adding and removing at a chunk
+    // boundary doesn't keep trading chunks with the pool
+    bool removeRow(unsigned row, ID &moved);
+
+    // Hands back every chunk with no rows in it, reserved or not
+    void shrink();
+
+    inline ID &getEntity(unsigned row)
+    {
+        return getEntities(row / _chunkCapacity)[row % _chunkCapacity];
+    }
+
+    inline Components::Component *&getComponent(unsigned row, unsigned column)
+    {
+        return getColumnData(row / _chunkCapacity, column)[row % _chunkCapacity];
+    }
+
+    inline Version getVersion(unsigned row, unsigned column)
+    {
+        return getVersionData(row / _chunkCapacity, column)[row % _chunkCapacity];
+    }
+
+    void setVersion(unsigned row, unsigned column, Version version)
+    {
+        auto chunk = row / _chunkCapacity;
+        getVersionData(chunk, column)[row % _chunkCapacity] = version;
+
+        auto &latest = _chunkVersions[chunk * _signature.size() + column];
+        latest = std::max(latest, version);
+    }
+
+    // Raw chunk access for iterating
+    inline unsigned getChunkSize(unsigned chunk) const
+    {
+        assert(chunk < getChunkCount());
+        return static_cast<unsigned>(
+            std::min<std::size_t>(_chunkCapacity,
+                                  _size - chunk * _chunkCapacity));
+    }
+
+    inline ID *getEntities(unsigned chunk)
+    {
+        assert(chunk < _chunks.size());
+        return reinterpret_cast<ID *>(_chunks[chunk]);
+    }
+
+    inline Components::Component **getColumnData(unsigned chunk,
+                                                 unsigned column)
+    {
+        assert(chunk < _chunks.size());
+        assert(column < _signature.size());
+        return reinterpret_cast<Components::Component **>(
+            _chunks[chunk] + _columnsOffset +
+            column * _chunkCapacity * sizeof(Components::Component *));
+    }
+
+    inline Version *getVersionData(unsigned chunk, unsigned column)
+    {
+        assert(chunk < _chunks.size());
+        assert(column < _signature.size());
+        return reinterpret_cast<Version *>(
+            _chunks[chunk] + _versionsOffset +
+            column * _chunkCapacity * sizeof(Version));
+    }
+
+    // Latest version of anything in the column that's been in the chunk.
+    // Only ever goes up, so it may be later than any row still there
+    inline Version getChunkVersion(unsigned chunk, unsigned column) const
+    {
+        assert(chunk < _chunks.size());
+        assert(column < _signature.size());
+        return _chunkVersions[chunk * _signature.size() + column];
+    }
+
+    // Cached transitions to the archetypes with one more or one fewer
+    // component type, filled in by EntityManager as it finds them
+    inline Archetype *getAddEdge(TypeId type) const
+    {
+        return type < _addEdges.size() ? _addEdges[type] : nullptr;
+    }
+
+    inline Archetype *getRemoveEdge(TypeId type) const
+    {
+        return type < _removeEdges.size() ? _removeEdges[type] : nullptr;
+    }
+
+    void setAddEdge(TypeId type, Archetype *to);
+    void setRemoveEdge(TypeId type, Archetype *to);
+
+    std::string toString() const override;
+
+private:
+    void addChunk();
+    void releaseChunk();
+
+    Signature _signature;
+
+    // Type ID to column, NO_COLUMN for types not in the signature
+    std::vector<unsigned> _columns;
+
+    std::size_t _size;
+    unsigned _chunkCapacity;
+    std::size_t _columnsOffset;
+    std::size_t _versionsOffset;
+    std::vector<unsigned char *> _chunks;
+
+    // Chunks asked for by reserve(), which removeRow() won't go below
+    std::size_t _reservedChunks;
+
+    // getChunkVersion() for every chunk and column, by chunk then column
+    std::vector<Version> _chunkVersions;
+
+    // Indexed by type ID
+    std::vector<Archetype *> _addEdges;
+    std::vector<Archetype *> _removeEdges;
+};
+
+#endif
@@ -0,0 +1,111 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_AUTOSAVER_H__
+#define __OGRE_AUTOSAVER_H__
+
+#include "defines.h"
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include "snapshot.h"
+#include "stringable.h"
+
+class EntityManager;
+
+// Saves the world every so often without holding up the frame for long.
+// The first save is a full snapshot, written to path. The saves after it
+// are deltas holding only what changed since the save before, written to
+// path.1, path.2 and so on, and every fullEvery-th save starts over with a
+// full snapshot. Only what's being saved is serialised on the calling
+// thread; files are written out on a thread of the Autosaver's own.
+//
+// A delta is no use once one before it is missing, so if a write fails the
+// deltas queued after it are dropped and the next save is a full snapshot.
+// The same goes if the writer falls MAX_QUEUED saves behind: what's queued
+// is dropped in favour of one full snapshot.
+//
+// Turns on change tracking in the EntityManager, which has to outlive the
+// Autosaver
+class Autosaver : public Stringable
+{
+public:
+    static constexpr unsigned MAX_QUEUED = 4;
+
+    Autosaver(EntityManager &manager, const std::string &path,
+              unsigned fullEvery = 10);
+
+    // Waits for anything still queued to be written
+    ~Autosaver();
+
+    Autosaver(const Autosaver &) = delete;
+    Autosaver &operator=(const Autosaver &) = delete;
+
+    // Captures what needs saving and queues it to be written. Only call
+    // this when no systems are running
+    void save();
+
+    // Waits until everything queued so far has been written
+    void flush();
+
+    // Loads the full snapshot at path and then each delta that follows it,
+    // stopping at the first that's missing or left over from an earlier
+    // snapshot
+    static Snapshot::Relocations load(EntityManager &manager,
+                                      const std::string &path);
+
+    std::string toString() const override;
+
+private:
+    struct Write
+    {
+        std::string path;
+        SnapshotWriter data;
+        std::uint64_t chain;
+        bool isDelta;
+    };
+
+    EntityManager &_manager;
+    std::string _path;
+    unsigned _fullEvery;
+
+    // Chain of the last full snapshot, 0 before the first or after a failed
+    // write, and how many deltas have followed it. The writer clears the
+    // chain, so it's guarded by the mutex
+    std::uint64_t _chain;
+    std::uint32_t _sequence;
+
+    // Chain whose deltas the writer skips, since one of its writes failed
+    std::uint64_t _brokenChain;
+
+    boost::mutex _mutex;
+    boost::condition_variable _wake;
+    boost::condition_variable _idle;
+    std::deque<Write> _queue;
+    bool _writing;
+    bool _stopping;
+    boost::thread _thread;
+
+    void writerLoop();
+};
+
+#endif
@@ -0,0 +1,139 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __OGRE_COMMANDBUFFER_H__
+#define __OGRE_COMMANDBUFFER_H__
+
+#include "defines.h"
+
+#include <functional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "debugname.h"
+#include "entity.h"
+#include "typeids.h"
+
+class EntityManager;
+
+// Structural changes recorded for EntityManager to make later, at a point
+// where nothing is iterating over it. Each thread records into its own
+// buffer, see EntityManager::getCommandBuffer, so recording takes no locks
+class CommandBuffer
+{
+    friend class EntityManager;
+
+public:
+    typedef Entity::ID ID;
+
+    CommandBuffer(EntityManager &manager) : _manager(manager) {}
+
+    CommandBuffer(const CommandBuffer &) = delete;
+    CommandBuffer &operator=(const CommandBuffer &) = delete;
+
+    // The ID is reserved straight away and can be used in further commands,
+    // but the entity won't exist until playback
+    ID createEntity(const std::string &debugName = "");
+
+    void destroyEntity(ID id);
+
+    // Calls C::create(id, args...) at playback, the same as
+    // Entity::component. Components are pooled and may own OGRE objects, so
+    // they're only ever made on the thread doing the playback. Skipped with
+    // a warning if by then the entity's gone or already has a C
+    template <class C, class... Args>
+    void addComponent(ID id, Args&& ... args)
+    {
+        static_assert(std::is_base_of<Components::Component, C>::value,
+                      "Can only add components of a type derived from class Components::Component");
+
+        Command command;
+        command.op = Op::AddComponent;
+        command.id = id;
+        command.componentType = TypeIds<Components::Component>::get<C>();
+        command.create =
+            [id, argsCopy = std::make_tuple(std::forward<Args>(args)...)]()
+            {
+                std::apply([id](const auto & ... a) { C::create(id, a...); },
+                           argsCopy);
+            };
+        _commands.push_back(std::move(command));
+    }
+
+    // The component is deleted at playback
+    template <class T>
+    void removeComponent(ID id)
+    {
+        static_assert(std::is_base_of<Components::Component, T>::value,
+                      "Can only remove components of a type derived from class Components::Component");
+
+        Command command;
+        command.op = Op::RemoveComponent;
+        command.id = id;
+        command.componentType = TypeIds<Components::Component>::get<T>();
+        _commands.push_back(std::move(command));
+    }
+
+    // Records that the entity's C has been modified, see
+    // EntityManager::markChanged. Marks are applied at playback, after
+    // everything else
+    template <class C>
+    void markChanged(ID id)
+    {
+        static_assert(std::is_base_of<Components::Component, C>::value,
+                      "Can only mark components of a type derived from class Components::Component");
+
+        _changes.push_back({ id, TypeIds<Components::Component>::get<C>() });
+    }
+
+    inline bool empty() const { return _commands.empty() && _changes.empty(); }
+    inline std::size_t size() const { return _commands.size(); }
+
+private:
+    // In the order they're played back
+    enum class Op
+    {
+        CreateEntity,
+        AddComponent,
+        RemoveComponent,
+        DestroyEntity
+    };
+
+    struct Command
+    {
+        Op op;
+        ID id;
+        unsigned componentType;
+        DebugName debugName;
+        std::function<void()> create;
+
+        Command() : componentType(0) {}
+    };
+
+    struct Change
+    {
+        ID id;
+        unsigned componentType;
+    };
+
+    EntityManager &_manager;
+    std::vector<Command> _commands;
+    std::vector<Change> _changes;
+};
+
+#endif
@@ -7,19 +7,24 @@
 #include <OgreSceneNode.h>
 
 #include "entity.h"
+#include "snapshot.h"
 
 namespace Components
 {
-    class Camera : public Component
+    class Camera : public Specific<Camera>
     {
+        friend struct SnapshotTraits<Camera>;
+
     public:
-        static Camera *create(const Entity::UUID &parent,
-                              const std::string &debugName = "Camera");
+        static Camera *create(Entity::ID parent,
+                              DebugName debugName = getTypeDebugName());
                                      
     private:
-        Camera(const Entity::UUID &parent, const std::string &debugName);
+        Camera(Entity::ID parent, DebugName debugName);
         
     public:        
+        ~Camera() override;
+
         Ogre::SceneNode *ogreSceneNode;
         Ogre::Camera *ogreCamera;
         
@@ -27,6 +32,16 @@ namespace Components
     };
 }
 
+// Saves the scene node's position and orientation
+template <>
+struct SnapshotTraits<Components::Camera>
+{
+    static constexpr std::uint32_t VERSION = 1;
+
+    static void save(const Components::Camera &camera, SnapshotWriter &out);
+    static Components::Camera *load(Entity::ID parent, SnapshotReader &in);
+};
+
 namespace Events
 {
     typedef SpecificComponentCreated<Components::Camera> CameraComponentCreated;
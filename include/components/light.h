@@ -7,19 +7,24 @@
 #include <OgreSceneNode.h>
 
 #include "entity.h"
+#include "snapshot.h"
 
 namespace Components
 {
-    class Light : public Component
+    class Light : public Specific<Light>
     {
+        friend struct SnapshotTraits<Light>;
+
     public:
-        static Light *create(const Entity::UUID &parent,
-                             const std::string &debugName = "Light");
+        static Light *create(Entity::ID parent,
+                             DebugName debugName = getTypeDebugName());
                                      
     private:
-        Light(const Entity::UUID &parent, const std::string &debugName);
+        Light(Entity::ID parent, DebugName debugName);
         
     public:        
+        ~Light() override;
+
         Ogre::SceneNode *ogreSceneNode;
         Ogre::Light *ogreLight;
         
@@ -27,6 +32,16 @@ namespace Components
     };
 }
 
+// Saves the scene node's position
+template <>
+struct SnapshotTraits<Components::Light>
+{
+    static constexpr std::uint32_t VERSION = 1;
+
+    static void save(const Components::Light &light, SnapshotWriter &out);
+    static Components::Light *load(Entity::ID parent, SnapshotReader &in);
+};
+
 namespace Events
 {
     typedef SpecificComponentCreated<Components::Light> LightComponentCreated;
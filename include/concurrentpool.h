@@ -0,0 +1,410 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_CONCURRENTPOOL_H__
+#define __OGRE_CONCURRENTPOOL_H__
+
+#include "defines.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "pool.h"
+
+// Compile-time-sized pool that can be allocated from and released to by any
+// number of threads without locking.
+//
+// Free slots live on a shared lock-free stack whose head is tagged with a
+// counter to rule out ABA. Each thread also keeps a small magazine of free
+// slots per pool, so most allocations and releases never touch the shared
+// stack at all. Slots sitting in another thread's magazine aren't available
+// to this one, so leave some headroom in N; a thread's magazine is returned
+// to the pool when the thread exits or calls flushThreadCache().
+//
+// Allocation and release counts are kept per magazine and only summed when
+// stats are requested. The reported peak is the most slots ever handed out
+// of the shared list, which includes slots idling in magazines, so it's an
+// upper bound on the real peak
+template <class T, unsigned N, unsigned MagazineSize = 32,
+          unsigned Options = PoolOptions::Default>
+class ConcurrentPool : public PoolBase
+{
+public:
+    ConcurrentPool();
+    ~ConcurrentPool();
+
+    template <class U = T>
+    U *allocate();
+
+    // As allocate(), but returns nullptr instead of throwing when empty
+    template <class U = T>
+    U *tryAllocate();
+
+    void release(T *object) noexcept;
+
+    // Returns any slots cached by the calling thread to the shared free list
+    void flushThreadCache() noexcept;
+
+    inline unsigned getCapacity() const { return N; }
+
+    PoolStats getStats() const override;
+
+private:
+    struct alignas(detail::poolSlotAlignment<T, Options>()) Slot
+    {
+        unsigned char data[sizeof(T)];
+    };
+
+    struct Magazine;
+
+    static constexpr std::uint32_t NIL = N;
+
+    // Everything the shared free list needs. Magazines hold a weak reference
+    // to this so a thread exiting after the pool is gone doesn't touch freed
+    // memory
+    struct Shared
+    {
+        PoolMemory::Block block;
+        Slot *slots;
+        std::unique_ptr<std::atomic<std::uint32_t>[]> next;
+
+        // Every thread hammers this, so keep it off everyone else's line
+        alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> head;
+
+        // Stats. Magazines are only added and removed as threads come and
+        // go, so the mutex stays off the hot path
+        mutable std::mutex magazinesMutex;
+        std::vector<const Magazine *> magazines;
+        std::atomic<std::uint64_t> retiredAllocations;
+        std::atomic<std::uint64_t> retiredReleases;
+        std::atomic<std::uint64_t> failures;
+        std::atomic<std::size_t> outstanding;
+        std::atomic<std::size_t> peak;
+
+        Shared();
+        ~Shared();
+
+        std::uint32_t pop() noexcept;
+        void push(std::uint32_t first, std::uint32_t last) noexcept;
+    };
+
+    struct Magazine
+    {
+        std::weak_ptr<Shared> owner;
+        unsigned count;
+        std::uint32_t slots[MagazineSize];
+
+        // Only ever written by the owning thread
+        std::atomic<std::uint64_t> allocations;
+        std::atomic<std::uint64_t> releases;
+
+        Magazine(const std::shared_ptr<Shared> &shared);
+        ~Magazine();
+
+        void flush(Shared &shared, unsigned keep) noexcept;
+    };
+
+    // Per-thread magazines, indexed by pool ID
+    struct ThreadCache
+    {
+        std::vector<std::unique_ptr<Magazine>> magazines;
+    };
+
+    std::shared_ptr<Shared> _shared;
+    unsigned _id;
+
+    Magazine &getMagazine();
+
+    static inline std::uint64_t pack(std::uint32_t index, std::uint32_t tag)
+    {
+        return (static_cast<std::uint64_t>(tag) << 32) | index;
+    }
+    static inline std::uint32_t indexOf(std::uint64_t head)
+    {
+        return static_cast<std::uint32_t>(head);
+    }
+    static inline std::uint32_t tagOf(std::uint64_t head)
+    {
+        return static_cast<std::uint32_t>(head >> 32);
+    }
+
+    static unsigned nextId()
+    {
+        static std::atomic<unsigned> id(0);
+        return id++;
+    }
+};
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+ConcurrentPool<T, N, MagazineSize, Options>::Shared::Shared() :
+    block(PoolMemory::allocate(N * sizeof(Slot), alignof(Slot),
+                               Options & PoolOptions::HugePages)),
+    slots(static_cast<Slot *>(block.data)),
+    next(new std::atomic<std::uint32_t>[N]),
+    head(pack(0, 0)),
+    retiredAllocations(0),
+    retiredReleases(0),
+    failures(0),
+    outstanding(0),
+    peak(0)
+{
+    for (std::uint32_t i = 0; i < N; i++)
+    {
+        next[i].store(i + 1, std::memory_order_relaxed);
+    }
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+ConcurrentPool<T, N, MagazineSize, Options>::Shared::~Shared()
+{
+    PoolMemory::release(block);
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+std::uint32_t ConcurrentPool<T, N, MagazineSize, Options>::Shared::pop() noexcept
+{
+    auto oldHead = head.load(std::memory_order_acquire);
+    for (;;)
+    {
+        auto index = indexOf(oldHead);
+        if (index == NIL) return NIL;
+
+        // If another thread has already popped this slot, the tag on the
+        // head will have changed and the exchange below fails
+        auto newHead = pack(next[index].load(std::memory_order_relaxed),
+                            tagOf(oldHead) + 1);
+        if (head.compare_exchange_weak(oldHead, newHead,
+                                       std::memory_order_acq_rel,
+                                       std::memory_order_acquire))
+        {
+            return index;
+        }
+    }
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+void ConcurrentPool<T, N, MagazineSize, Options>::Shared::push(
+        std::uint32_t first, std::uint32_t last) noexcept
+{
+    // Pushes an already-linked chain of slots in a single exchange
+    auto oldHead = head.load(std::memory_order_relaxed);
+    std::uint64_t newHead;
+    do
+    {
+        next[last].store(indexOf(oldHead), std::memory_order_relaxed);
+        newHead = pack(first, tagOf(oldHead) + 1);
+    } while (!head.compare_exchange_weak(oldHead, newHead,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+ConcurrentPool<T, N, MagazineSize, Options>::Magazine::Magazine(
+        const std::shared_ptr<Shared> &shared) :
+    owner(shared),
+    count(0),
+    allocations(0),
+    releases(0)
+{
+    std::lock_guard<std::mutex> lock(shared->magazinesMutex);
+    shared->magazines.push_back(this);
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+ConcurrentPool<T, N, MagazineSize, Options>::Magazine::~Magazine()
+{
+    if (auto shared = owner.lock())
+    {
+        flush(*shared, 0);
+
+        // Fold this thread's counts into the pool's totals
+        std::lock_guard<std::mutex> lock(shared->magazinesMutex);
+        shared->retiredAllocations += allocations.load(std::memory_order_relaxed);
+        shared->retiredReleases += releases.load(std::memory_order_relaxed);
+
+        auto &magazines = shared->magazines;
+        magazines.erase(std::remove(magazines.begin(), magazines.end(), this),
+                        magazines.end());
+    }
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+void ConcurrentPool<T, N, MagazineSize, Options>::Magazine::flush(
+        Shared &shared, unsigned keep) noexcept
+{
+    if (count <= keep) return;
+
+    // Link the surplus into a chain and hand it back in one go
+    for (unsigned i = keep; i < count - 1; i++)
+    {
+        shared.next[slots[i]].store(slots[i + 1], std::memory_order_relaxed);
+    }
+    shared.push(slots[keep], slots[count - 1]);
+    shared.outstanding.fetch_sub(count - keep, std::memory_order_relaxed);
+    count = keep;
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+ConcurrentPool<T, N, MagazineSize, Options>::ConcurrentPool() :
+    PoolBase(typeid(T), "ConcurrentPool"),
+    _shared(std::make_shared<Shared>()),
+    _id(nextId())
+{
+    static_assert(N > 0,
+                  "pool capacity must be greater than zero");
+    static_assert(MagazineSize > 1,
+                  "magazine size must be greater than one");
+
+    registerPool();
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+ConcurrentPool<T, N, MagazineSize, Options>::~ConcurrentPool()
+{
+    unregisterPool();
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+typename ConcurrentPool<T, N, MagazineSize, Options>::Magazine &
+ConcurrentPool<T, N, MagazineSize, Options>::getMagazine()
+{
+    static thread_local ThreadCache cache;
+
+    auto &magazines = cache.magazines;
+    if (_id >= magazines.size())
+    {
+        magazines.resize(_id + 1);
+    }
+    if (!magazines[_id])
+    {
+        magazines[_id].reset(new Magazine(_shared));
+    }
+
+    return *magazines[_id];
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+template <class U>
+U *ConcurrentPool<T, N, MagazineSize, Options>::allocate()
+{
+    auto object = tryAllocate<U>();
+    if (!object) throw Exceptions::PoolOutOfMemory(typeid(T));
+    return object;
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+template <class U>
+U *ConcurrentPool<T, N, MagazineSize, Options>::tryAllocate()
+{
+    static_assert(std::is_base_of<T, U>::value,
+                  "can only allocate objects of or subclassed from pool base type");
+    static_assert(sizeof(T) == sizeof(U),
+                  "can only allocate subclasses of identical size to pool base type");
+
+    auto &magazine = getMagazine();
+
+    // Refill half the magazine from the shared list when it runs dry
+    if (!magazine.count)
+    {
+        while (magazine.count < MagazineSize / 2)
+        {
+            auto index = _shared->pop();
+            if (index == NIL) break;
+            magazine.slots[magazine.count++] = index;
+        }
+
+        if (!magazine.count)
+        {
+            _shared->failures.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        auto outstanding = _shared->outstanding.fetch_add(
+            magazine.count, std::memory_order_relaxed) + magazine.count;
+        auto peak = _shared->peak.load(std::memory_order_relaxed);
+        while (outstanding > peak &&
+               !_shared->peak.compare_exchange_weak(peak, outstanding,
+                                                    std::memory_order_relaxed)) {}
+    }
+
+    magazine.allocations.store(
+        magazine.allocations.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+
+    auto index = magazine.slots[--magazine.count];
+    return reinterpret_cast<U *>(&_shared->slots[index]);
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+void ConcurrentPool<T, N, MagazineSize, Options>::release(T *object) noexcept
+{
+    assert(object);
+
+    auto slot = reinterpret_cast<Slot *>(object);
+    assert(slot >= _shared->slots);
+    assert(slot < _shared->slots + N);
+
+    auto &magazine = getMagazine();
+
+    // Spill half the magazine back to the shared list when it's full
+    if (magazine.count == MagazineSize)
+    {
+        magazine.flush(*_shared, MagazineSize / 2);
+    }
+
+    magazine.slots[magazine.count++] =
+        static_cast<std::uint32_t>(slot - _shared->slots);
+
+    magazine.releases.store(
+        magazine.releases.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+void ConcurrentPool<T, N, MagazineSize, Options>::flushThreadCache() noexcept
+{
+    getMagazine().flush(*_shared, 0);
+}
+
+template <class T, unsigned N, unsigned MagazineSize, unsigned Options>
+PoolStats ConcurrentPool<T, N, MagazineSize, Options>::getStats() const
+{
+    PoolStats stats;
+    stats.capacity = N;
+    stats.failures = _shared->failures.load(std::memory_order_relaxed);
+    stats.peak = _shared->peak.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(_shared->magazinesMutex);
+    stats.allocations = _shared->retiredAllocations.load(std::memory_order_relaxed);
+    stats.releases = _shared->retiredReleases.load(std::memory_order_relaxed);
+    for (auto magazine : _shared->magazines)
+    {
+        stats.allocations += magazine->allocations.load(std::memory_order_relaxed);
+        stats.releases += magazine->releases.load(std::memory_order_relaxed);
+    }
+    stats.live = static_cast<std::size_t>(stats.allocations - stats.releases);
+
+    return stats;
+}
+
+#endif
@@ -0,0 +1,94 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_DEBUGNAME_H__
+#define __OGRE_DEBUGNAME_H__
+
+#include "defines.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Debug names are only kept in debug builds. Without _DEBUG_NAMES a
+// DebugName is an empty placeholder and nothing is stored or looked up
+#ifdef _DEBUG
+#   define _DEBUG_NAMES
+#endif
+
+namespace detail
+{
+    // Process-wide table behind DebugName. Thread-safe
+    std::uint32_t internDebugName(const std::string &name);
+    const std::string &getDebugName(std::uint32_t id);
+}
+
+// Small handle to a string in a process-wide intern table, so each distinct
+// name is stored once however many entities or components carry it. Names
+// are never removed from the table, so this is meant for the usual bounded
+// set of names rather than anything generated per object.
+//
+// Deliberately not Stringable, to keep it to a single 32-bit word
+class DebugName final
+{
+public:
+#ifdef _DEBUG_NAMES
+    DebugName() : _id(0) {}
+    DebugName(const std::string &name) : _id(detail::internDebugName(name)) {}
+    DebugName(const char *name) : _id(detail::internDebugName(name)) {}
+
+    inline const std::string &str() const { return detail::getDebugName(_id); }
+    inline bool empty() const { return _id == 0; }
+
+    inline bool operator==(const DebugName &other) const
+    {
+        return _id == other._id;
+    }
+#else
+    DebugName() {}
+    DebugName(const std::string &) {}
+    DebugName(const char *) {}
+
+    inline const std::string &str() const
+    {
+        static const std::string empty;
+        return empty;
+    }
+    inline bool empty() const { return true; }
+
+    inline bool operator==(const DebugName &) const { return true; }
+#endif
+
+    inline bool operator!=(const DebugName &other) const
+    {
+        return !(*this == other);
+    }
+
+#ifdef _DEBUG_NAMES
+private:
+    // 0 is always the empty string
+    std::uint32_t _id;
+#endif
+};
+
+inline std::ostream &operator<<(std::ostream &os, const DebugName &name)
+{
+    os << name.str();
+    return os;
+}
+
+#endif
@@ -1,7 +1,6 @@
 #ifndef __OGRE_DEFINES_H__
 #define __OGRE_DEFINES_H__
 
-#define _DEBUG
 #define BOOST_ALL_DYN_LINK
 
 #endif
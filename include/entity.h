@@ -21,14 +21,23 @@
 #include "defines.h"
 
 #include <boost/core/demangle.hpp>
+#include <cassert>
 #include <memory>
 #include <sstream>
+#include <typeinfo>
+#include <utility>
+#include <vector>
 
+#include "debugname.h"
+#include "entityid.h"
 #include "events.h"
 #include "pool.h"
+#include "sizeclasspool.h"
 #include "stringable.h"
 #include "uuid.h"
 
+// Initial number of blocks in each component type's pool, and in each size
+// class of the shared pool
 static constexpr unsigned COMPONENT_POOL_SIZE = 100;
 
 #ifdef _DEBUG
@@ -45,10 +54,10 @@ class Entity final : public Stringable
     friend class EntityManager;
 
 public:
-    typedef uuid::uuid UUID;
+    typedef EntityID ID;
 
     // Call this to create and register the Entity with the EntityManager
-    static UUID create(const std::string &debugName);
+    static ID create(const std::string &debugName);
 
     // Call this constructor to do the above, as well as provide a light
     // class instance to allow for chaining Component calls and using
@@ -56,10 +65,14 @@ public:
     Entity(const std::string &debugName);
 
     // Call this constructor to create the Entity instance with an existing
-    // UUID, without registering it as a new entity
-    Entity(UUID uuid) : _uuid(uuid) {}
+    // ID, without registering it as a new entity
+    Entity(ID id) : _id(id) {}
 
-    inline UUID getUUID() const { return _uuid; }
+    inline ID getID() const { return _id; }
+
+    // Persistent identity, for entities that need one. See
+    // EntityManager::getUUID
+    const uuid::uuid &getUUID() const;
 
     const std::string &getDebugName() const;
 
@@ -70,7 +83,7 @@ public:
         static_assert(std::is_base_of<Components::Component, C>::value,
                       "Can only add components of a type derived from class Components::Component");
 
-        C::create(_uuid, std::forward<Args>(args)...);
+        C::create(_id, std::forward<Args>(args)...);
 
         return *this;
     }
@@ -78,32 +91,139 @@ public:
     std::string toString() const;
 
 private:
-    UUID _uuid;
+    ID _id;
 };
 
 // The component base class is in this file to prevent cyclic preprocessor includes
 namespace Components
 {
-    class Component : public Stringable
+    namespace detail
+    {
+        // Raw storage for one T, the element type of T's pool
+        template <class T>
+        struct alignas(T) Storage
+        {
+            unsigned char bytes[sizeof(T)];
+        };
+    }
+
+    // Components are allocated out of pools rather than the general heap.
+    // Those derived from Specific get a pool per type, anything else comes
+    // out of a shared size class pool
+    class Component : public Stringable,
+                      public SizeClassPoolable<Component, COMPONENT_POOL_SIZE>
     {
     protected:
-        Component(const Entity::UUID &parentUUID, const std::string &debugName = "Component");
+        Component(Entity::ID parent, DebugName debugName = DebugName());
 
     public:
         virtual ~Component();
 
-        inline std::string getDebugName() const { return _debugName; }
-        inline Entity::UUID getParent() const { return _parentUUID; }
+        // The parent's debug name followed by the component's own. Only put
+        // together when asked for, and always empty in release builds
+        std::string getDebugName() const;
+        inline Entity::ID getParent() const { return _parent; }
 
         std::string toString() const override;
 
     protected:
-        //inline void setDebugName(const std::string &name) { _debugName = name; }
-        inline void setDebugName(std::string &&name) { _debugName = std::move(name); }
+        inline void setDebugName(const std::string &name) { _debugName = name; }
+
+        // Name for an engine-side object the component owns, such as an
+        // OGRE camera. Never handed out twice, since a snapshot load builds
+        // an entity's new components while its old ones are still alive
+        static std::string makeUniqueName(const std::string &prefix);
 
     private:
-        Entity::UUID _parentUUID;
-        std::string _debugName;
+        Entity::ID _parent;
+        DebugName _debugName;
+    };
+
+    // Base for concrete component types. Most components go by their type's
+    // name, so that's interned once per type the first time it's needed,
+    // rather than on every construction.
+    //
+    // Components of exactly type T come out of a pool of their own, so each
+    // type's data sits together in memory and walking one archetype column
+    // walks mostly forwards through it. Subclasses of T are a different
+    // size and fall back to the shared pool
+    template <class T>
+    class Specific : public Component
+    {
+    public:
+        static void *operator new(std::size_t sz)
+        {
+            if (sz != sizeof(T)) return Component::operator new(sz);
+            return getTypePool().allocate();
+        }
+
+        static void operator delete(void *p, std::size_t sz)
+        {
+            if (sz != sizeof(T))
+            {
+                Component::operator delete(p, sz);
+            }
+            else if (p)
+            {
+                getTypePool().release(static_cast<detail::Storage<T> *>(p));
+            }
+        }
+
+        static PoolStats getTypePoolStats()
+        {
+            return getTypePool().getStats();
+        }
+
+        // Generational handle to this component. Unlike a pointer it's safe
+        // to hang on to across frames: once the component's been deleted it
+        // resolves to null rather than to whatever reuses the slot. Only
+        // components of exactly type T have one
+        Handle<T> getHandle() const
+        {
+            assert(typeid(*this) == typeid(T));
+
+            auto handle = getTypePool().getHandle(
+                reinterpret_cast<const detail::Storage<T> *>(
+                    static_cast<const T *>(this)));
+            return Handle<T>(handle.getIndex(), handle.getGeneration());
+        }
+
+        static T *resolve(Handle<T> handle)
+        {
+            auto storage = getTypePool().resolve(
+                Handle<detail::Storage<T>>(handle.getIndex(),
+                                           handle.getGeneration()));
+            return reinterpret_cast<T *>(storage);
+        }
+
+        // T's name without its namespace, e.g. "Camera"
+        static DebugName getTypeDebugName()
+        {
+#ifdef _DEBUG_NAMES
+            static const DebugName name = []
+            {
+                auto name = boost::core::demangle(typeid(T).name());
+                auto colon = name.rfind("::");
+                return DebugName(colon == std::string::npos ?
+                                 name : name.substr(colon + 2));
+            }();
+            return name;
+#else
+            return DebugName();
+#endif
+        }
+
+    protected:
+        Specific(Entity::ID parent, DebugName debugName = getTypeDebugName()) :
+            Component(parent, debugName) {}
+
+        typedef GrowablePool<detail::Storage<T>, COMPONENT_POOL_SIZE> TypePool;
+
+        static TypePool &getTypePool()
+        {
+            static TypePool pool;
+            return pool;
+        }
     };
 }
 
@@ -113,16 +233,16 @@ namespace Events
     class EntityCreated : public Events::Event
     {
     public:
-        Entity::UUID uuid;
+        Entity::ID id;
 
-        EntityCreated(Entity::UUID uuid_) :
+        EntityCreated(Entity::ID id_) :
             Events::Event(),
-            uuid(uuid_) {}
+            id(id_) {}
 
         std::string toString() const
         {
             std::ostringstream ss;
-            ss << "Events::EntityCreated[uuid = " << uuid << "]";
+            ss << "Events::EntityCreated[id = " << id << "]";
             return ss.str();
         }
     };
@@ -130,17 +250,53 @@ namespace Events
     class EntityDestroyed : public Events::Event
     {
     public:
-        Entity::UUID uuid;
+        Entity::ID id;
+
+        EntityDestroyed(Entity::ID id_) :
+            Events::Event(),
+            id(id_) {}
+
+
+        std::string toString() const
+        {
+            std::ostringstream ss;
+            ss << "Events::EntityDestroyed[id = " << id << "]";
+            return ss.str();
+        }
+    };
+
+    // Raised once for a whole batch by EntityManager::createEntities
+    class EntitiesCreated : public Events::Event
+    {
+    public:
+        std::vector<Entity::ID> ids;
 
-        EntityDestroyed(Entity::UUID uuid_) :
+        EntitiesCreated(std::vector<Entity::ID> ids_) :
             Events::Event(),
-            uuid(uuid_) {}
+            ids(std::move(ids_)) {}
 
+        std::string toString() const
+        {
+            std::ostringstream ss;
+            ss << "Events::EntitiesCreated[count = " << ids.size() << "]";
+            return ss.str();
+        }
+    };
+
+    // Raised once for a whole batch by EntityManager::destroyEntities
+    class EntitiesDestroyed : public Events::Event
+    {
+    public:
+        std::vector<Entity::ID> ids;
+
+        EntitiesDestroyed(std::vector<Entity::ID> ids_) :
+            Events::Event(),
+            ids(std::move(ids_)) {}
 
         std::string toString() const
         {
             std::ostringstream ss;
-            ss << "Events::EntityDestroyed[uuid = " << uuid << "]";
+            ss << "Events::EntitiesDestroyed[count = " << ids.size() << "]";
             return ss.str();
         }
     };
@@ -0,0 +1,138 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __OGRE_ENTITYID_H__
+#define __OGRE_ENTITYID_H__
+
+#include "defines.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+// Compact entity identifier: an index into EntityManager's entity table in
+// the low bits, and the generation of that table slot in the high bits. The
+// generation goes up every time the slot's entity is destroyed, so stale
+// IDs don't resolve to whichever entity reuses the slot. The generation
+// wraps, but only after a slot has been reused GENERATION_MASK + 1 times.
+//
+// Like Handle, deliberately not Stringable, to keep it to 32 bits
+class EntityID final
+{
+public:
+    static constexpr unsigned INDEX_BITS = 22;
+    static constexpr std::uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static constexpr std::uint32_t GENERATION_MASK = ~0u >> INDEX_BITS;
+
+    // Largest usable index, one less than the mask so that no valid ID
+    // ever equals NULL_VALUE
+    static constexpr std::uint32_t MAX_INDEX = INDEX_MASK - 1;
+    static constexpr std::uint32_t NULL_VALUE = ~0u;
+
+    EntityID() : _value(NULL_VALUE) {}
+    EntityID(std::uint32_t index, std::uint32_t generation) :
+        _value(((generation & GENERATION_MASK) << INDEX_BITS) |
+               (index & INDEX_MASK)) {}
+
+    static inline EntityID fromValue(std::uint32_t value)
+    {
+        EntityID id;
+        id._value = value;
+        return id;
+    }
+
+    inline std::uint32_t getIndex() const { return _value & INDEX_MASK; }
+    inline std::uint32_t getGeneration() const { return _value >> INDEX_BITS; }
+    inline std::uint32_t getValue() const { return _value; }
+
+    // Same slot, next generation
+    inline EntityID next() const
+    {
+        return EntityID(getIndex(), getGeneration() + 1);
+    }
+
+    inline bool isNull() const { return _value == NULL_VALUE; }
+    inline explicit operator bool() const { return !isNull(); }
+
+    inline bool operator==(const EntityID &other) const
+    {
+        return _value == other._value;
+    }
+
+    inline bool operator!=(const EntityID &other) const
+    {
+        return _value != other._value;
+    }
+
+    inline bool operator<(const EntityID &other) const
+    {
+        return _value < other._value;
+    }
+
+    std::string toString() const;
+
+private:
+    std::uint32_t _value;
+};
+
+inline std::ostream &operator<<(std::ostream &os, const EntityID &id)
+{
+    if (id.isNull())
+    {
+        os << "null";
+    }
+    else
+    {
+        os << id.getIndex() << "v" << id.getGeneration();
+    }
+    return os;
+}
+
+inline std::string EntityID::toString() const
+{
+    std::string s = "EntityID[";
+    if (isNull())
+    {
+        s += "null";
+    }
+    else
+    {
+        s += std::to_string(getIndex()) + "v" + std::to_string(getGeneration());
+    }
+    return s + "]";
+}
+
+// For boost::hash
+inline std::size_t hash_value(const EntityID &id)
+{
+    return id.getValue();
+}
+
+namespace std
+{
+    template <>
+    struct hash<EntityID>
+    {
+        inline std::size_t operator()(const EntityID &id) const
+        {
+            return id.getValue();
+        }
+    };
+}
+
+#endif
@@ -20,41 +20,59 @@
 
 #include "defines.h"
 
+#include <algorithm>
 #include <boost/functional/hash.hpp>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
+#include "archetype.h"
+#include "commandbuffer.h"
+#include "debugname.h"
 #include "entity.h"
 #include "events.h"
 #include "logger.h"
-#include "pool.h"
+#include "poolallocator.h"
+#include "query.h"
 #include "stringable.h"
+#include "typeids.h"
+#include "uuid.h"
+#include "view.h"
 
 namespace Exceptions
 {
     class NoSuchEntity : public Exception
     {
     public:
-        NoSuchEntity(const Entity::UUID &uuid) : Exception(error(uuid)) {}
+        NoSuchEntity(const Entity::ID &id) : Exception(error(id)) {}
 
     private:
-        std::string error(const Entity::UUID &uuid)
+        std::string error(const Entity::ID &id)
         {
             std::ostringstream ss;
-            ss << "no such entity with UUID " << uuid;
+            ss << "no such entity with ID " << id;
             return ss.str();
         }
     };
 
-    class EntityExists : public Exception
+    class TooManyEntities : public Exception
     {
     public:
-        EntityExists(const Entity::UUID &uuid) : Exception(error(uuid)) {}
+        TooManyEntities() : Exception(error()) {}
 
     private:
-        std::string error(const Entity::UUID &uuid)
+        std::string error()
         {
             std::ostringstream ss;
-            ss << "entity already exists with UUID " << uuid;
+            ss << "can't have more than " << EntityID::MAX_INDEX + 1
+               << " entities at once";
             return ss.str();
         }
     };
@@ -62,23 +80,23 @@ namespace Exceptions
     class NoSuchComponent : public Exception
     {
     public:
-        NoSuchComponent(const Entity::UUID &uuid,
+        NoSuchComponent(const Entity::ID &id,
                         const std::type_info &type) :
-            Exception(error(uuid, type)) {}
+            Exception(error(id, type)) {}
 
         NoSuchComponent(const Entity &entity,
                         const std::type_info &type) :
-            Exception(error(entity.getUUID(), type)) {}
+            Exception(error(entity.getID(), type)) {}
 
         NoSuchComponent(const Entity *entity,
                         const std::type_info &type) :
-            Exception(error(entity->getUUID(), type)) {}
+            Exception(error(entity->getID(), type)) {}
 
     private:
-        std::string error(const Entity::UUID &uuid, const std::type_info &type)
+        std::string error(const Entity::ID &id, const std::type_info &type)
         {
             std::ostringstream ss;
-            ss << "entity " << uuid << " does not contain a component "
+            ss << "entity " << id << " does not contain a component "
                << "of type " << boost::core::demangle(type.name());
             return ss.str();
         }
@@ -102,89 +120,410 @@ namespace Exceptions
     };
 }
 
+// Entities are grouped into archetypes by the exact set of component types
+// they have, see Archetype. Adding or removing a component moves the entity
+// into the archetype matching its new set
 class EntityManager : public Stringable, public Events::Subscriber
 {
+    friend class Snapshot;
+
 public:
-    typedef Entity::UUID UUID;
+    typedef Entity::ID ID;
 
     EntityManager();
     ~EntityManager();
 
-    UUID createEntity(const std::string &debugName = "");
-    void destroyEntity(UUID uuid);
+    ID createEntity(const std::string &debugName = "");
+
+    // Destroys the entity along with every component it still has
+    void destroyEntity(ID id);
+
+    // Batch versions of the above, for spawning or clearing out lots of
+    // entities at once. Space is reserved up front and a single
+    // EntitiesCreated or EntitiesDestroyed event is raised for the lot
+    // rather than one event per entity
+    std::vector<ID> createEntities(std::size_t count,
+                                   const std::string &debugName = "");
+    void destroyEntities(const std::vector<ID> &ids);
+
+    bool isAlive(ID id) const;
+
+    // Picks out an ID for an entity that'll be created later, see
+    // CommandBuffer. Safe to call from any thread
+    ID reserveEntity();
+
+    // As above, for a whole batch under one lock
+    std::vector<ID> reserveEntities(std::size_t count);
+
+    // Entities only have a UUID if they need an identity that outlives the
+    // process, e.g. to be saved or sent over the network. getUUID assigns
+    // one the first time it's asked, setUUID gives an entity a known one,
+    // e.g. when loading it back in
+    const uuid::uuid &getUUID(ID id);
+    bool hasUUID(ID id) const;
+    void setUUID(ID id, const uuid::uuid &uuid);
+
+    // The entity with the given UUID, or a null ID
+    ID findEntity(const uuid::uuid &uuid) const;
+
+    template <class T>
+    T *getComponent(ID id);
+
+    // Like getComponent, but returns null rather than throwing if either the
+    // entity or the component doesn't exist. Prefer this in systems
+    template <class T>
+    T *tryGetComponent(ID id);
+
+    // Detaches a component from its entity and hands it back to the caller,
+    // who then owns it. Otherwise components belong to the EntityManager
+    template <class T>
+    T *removeComponent(ID id);
 
+    // Handle to the entity's T, for holding on to it beyond the current
+    // frame; see Components::Specific::getHandle. Resolve it with
+    // T::resolve(). Throws the same as getComponent
     template <class T>
-    T *getComponent(UUID uuid);
+    Handle<T> getHandle(ID id);
+
+    // Every entity that has all of the components Cs...
+    template <class... Cs>
+    View<Cs...> view();
+
+    // Calls fn(id, Cs &...) for every entity that has all of the components
+    // Cs..., without building a View first. fn mustn't add or remove
+    // components
+    template <class... Cs, class F>
+    void each(F fn);
+
+    // Like each(), but only visits entities where at least one of Cs...
+    // has changed at or after the given version. Chunks where none of them
+    // have are skipped without looking at their rows
+    template <class... Cs, class F>
+    void eachChanged(Archetype::Version since, F fn);
+
+    // Persistent version of view(), for queries that get run over and over.
+    // Made the first time it's asked for and kept up to date from then on,
+    // so running it costs nothing beyond visiting what it matches. Owned by
+    // the EntityManager
+    template <class... Cs>
+    Query<Cs...> &query();
+
+    // Change tracking, for autosaves. While it's on, every entity that's
+    // created, gains or loses a component or is marked changed is remembered
+    // until the next takeChanges(), as is every entity that's destroyed.
+    // Turning it on or off forgets anything remembered so far
+    void setChangeTracking(bool enabled);
+    inline bool isTrackingChanges() const { return _trackChanges; }
+
+    // Records that the entity's C has been modified, stamping it with the
+    // current version. Main thread only, systems should go through
+    // CommandBuffer::markChanged
+    template <class C>
+    void markChanged(ID id);
+
+    // Version that changes are being stamped with. It starts at 1 and goes
+    // up after each playback, which stamps its own changes first. Adding a
+    // component counts as changing it.
+    //
+    // To sync only what's changed, keep the version from the last pass and
+    // hand it to eachChanged(), then keep getVersion() for the next one. A
+    // change made after a pass but within the same version is visited on
+    // the next pass as well, so nothing's ever missed
+    inline Archetype::Version getVersion() const { return _version; }
+
+    struct Changes
+    {
+        // Still alive, each listed once
+        std::vector<ID> changed;
+        std::vector<ID> destroyed;
+    };
+
+    // Everything remembered since the last call, see setChangeTracking
+    Changes takeChanges();
+
+    // The calling thread's command buffer. Systems record structural
+    // changes here rather than making them while others may be iterating
+    CommandBuffer &getCommandBuffer();
+
+    // Applies and clears every thread's command buffer in one batch: all
+    // entity creations, then component additions, then removals, then
+    // entity destructions, then change marks. Moves on to the next version
+    // afterwards, whether or not there was anything to apply. Only call this
+    // when no systems are running
+    void playback();
+
+    // Hands back every archetype chunk that has no rows in it, e.g. after a
+    // level's been torn down. Archetypes otherwise hang on to what they've
+    // reserved, see Archetype::reserve
+    void shrink();
 
     //void onEvent(const Events::EntityCreated &event);
     void onEvent(const Events::ComponentCreated &event);
 
-    const std::string &getDebugName(UUID uuid) const;
+    // Always empty in release builds
+    const std::string &getDebugName(ID id) const;
 
-    std::string toString() const;
+    std::string toString() const override;
+
+    // The manager that Entity and Component go through, if any
+    static EntityManager *getCurrent();
+    static void setCurrent(EntityManager *manager);
 
 private:
-    // Entity memory pool
-    static constexpr unsigned ENTITY_POOL_CAPACITY = 100;
-    Pool<Entity, ENTITY_POOL_CAPACITY> _entityPool;
-
-    // Subject to change based on performance considerations
-    typedef std::unordered_map<std::type_index, Components::Component*> ComponentMap;
-    typedef std::unordered_map<UUID, ComponentMap, boost::hash<UUID>>
-        EntityMap;
-    EntityMap _map;
-
-    // Moved from Entity class
-    typedef std::unordered_map<UUID, std::string, boost::hash<UUID>>
-        EntityDebugNameMap;
-    EntityDebugNameMap _debugNameMap;
+    // Where each entity's row lives, indexed by ID index. Free and
+    // reserved slots have a null archetype
+    struct EntityRecord
+    {
+        Archetype *archetype;
+        unsigned row;
+        ID id;
+    };
+
+    std::vector<EntityRecord> _records;
+    std::size_t _entityCount;
+
+    // IDs that are up for grabs, already on their next generation. Slots
+    // are reused oldest first so generations wrap as slowly as possible
+    std::mutex _freeMutex;
+    std::deque<ID> _freeIds;
+    std::uint32_t _nextIndex;
+
+    typedef std::map<Archetype::Signature, std::unique_ptr<Archetype>>
+        ArchetypeMap;
+    ArchetypeMap _archetypes;
+    Archetype *_emptyArchetype;
+
+    // Indexed by component type ID, every archetype that has that type
+    std::vector<std::vector<Archetype *>> _archetypesWith;
+
+    // Indexed by query type ID
+    std::vector<std::unique_ptr<QueryBase>> _queries;
+
+#ifdef _DEBUG_NAMES
+    // Moved from Entity class, indexed by ID index
+    std::vector<DebugName> _debugNames;
+#endif
+
+    // Persistent identities, for the entities that have one. Nodes and
+    // bucket arrays come out of pools rather than the general heap
+    typedef std::unordered_map<ID, uuid::uuid, std::hash<ID>,
+                               std::equal_to<ID>,
+                               PoolAllocator<std::pair<const ID, uuid::uuid>>>
+        UUIDMap;
+    typedef std::unordered_map<uuid::uuid, ID, boost::hash<uuid::uuid>,
+                               std::equal_to<uuid::uuid>,
+                               PoolAllocator<std::pair<const uuid::uuid, ID>>>
+        EntityByUUIDMap;
+    UUIDMap _uuids;
+    EntityByUUIDMap _entitiesByUUID;
+
+    // See setChangeTracking. _changedSlots holds, by ID index, the ID last
+    // added to _changedIds for that slot
+    bool _trackChanges;
+    std::vector<ID> _changedSlots;
+    std::vector<ID> _changedIds;
+    std::vector<ID> _destroyedIds;
+
+    // See getVersion
+    Archetype::Version _version;
+
+    // Every command buffer handed out, one per thread that's asked. Each
+    // thread caches its own, indexed by _id
+    unsigned _id;
+    std::mutex _commandBuffersMutex;
+    std::vector<std::unique_ptr<CommandBuffer>> _commandBuffers;
+
+    Archetype *getArchetype(const Archetype::Signature &signature);
+    Archetype *getArchetypeWith(Archetype *from, Archetype::TypeId type);
+    Archetype *getArchetypeWithout(Archetype *from, Archetype::TypeId type);
+    EntityRecord *findRecord(ID id);
+    const EntityRecord *findRecord(ID id) const;
+
+    // Fills in the record for a reserved ID, adding a row for it to the
+    // given archetype or the empty one. The row's components are left null
+    void insertEntity(ID id, DebugName debugName,
+                      Archetype *archetype = nullptr);
+
+    // Clears the record and frees the ID. The entity's components have to
+    // have been dealt with already
+    void eraseEntity(EntityRecord &record);
+
+    void noteChanged(ID id);
+
+    // Stamps one of the entity's components with the current version,
+    // returning false if it doesn't have one of that type
+    bool stampChanged(ID id, Archetype::TypeId type);
+
+    void moveEntity(EntityRecord &record, Archetype *to);
+    void removeRow(const EntityRecord &record);
+
+    // Takes the component of the given type off the entity and returns it,
+    // or null if there isn't one
+    Components::Component *detachComponent(ID id, Archetype::TypeId type);
+
+    // Calls fn(archetype, columns) for each archetype with all of Cs...,
+    // starting from whichever of the types is in the fewest archetypes.
+    // One-shot walks can skip empty archetypes, but a View has to keep
+    // them, since entities may move into them later
+    template <class... Cs, class F>
+    void forEachArchetype(F fn, bool skipEmpty);
 };
 
 template <class T>
-T *EntityManager::getComponent(UUID uuid)
+T *EntityManager::getComponent(ID id)
 {
-    // First, see if we have an entity entry that matches uuid
-    ComponentMap componentsMap;
-    try
-    {
-        componentsMap = _map.at(uuid);
-    }
-    catch (std::out_of_range)
+    T *ptr = tryGetComponent<T>(id);
+    if (ptr) return ptr;
+
+    // Only work out what went wrong once we know something has
+    if (!isAlive(id))
     {
-        throw Exceptions::NoSuchEntity(uuid);
+        throw Exceptions::NoSuchEntity(id);
     }
+    throw Exceptions::NoSuchComponent(id, typeid(T));
+}
+
+template <class T>
+T *EntityManager::tryGetComponent(ID id)
+{
+    static_assert(std::is_base_of<Components::Component, T>::value,
+                  "Can only get components of a type derived from class Components::Component");
+
+    auto record = findRecord(id);
+    if (!record) return nullptr;
 
-    // Try to find an entry for type T
-    Components::Component *basePtr = nullptr;
-    try
+    auto column = record->archetype->getColumn(
+        TypeIds<Components::Component>::get<T>());
+    if (column == Archetype::NO_COLUMN) return nullptr;
+
+    // Components are filed under their exact type, so the column for T can
+    // only ever hold a T and there's no need for dynamic_cast
+    return static_cast<T *>(record->archetype->getComponent(record->row, column));
+}
+
+template <class T>
+T *EntityManager::removeComponent(ID id)
+{
+    T *component = getComponent<T>(id);
+    detachComponent(id, TypeIds<Components::Component>::get<T>());
+    return component;
+}
+
+template <class T>
+Handle<T> EntityManager::getHandle(ID id)
+{
+    static_assert(std::is_base_of<Components::Specific<T>, T>::value,
+                  "handles are only for components derived from Specific");
+
+    return getComponent<T>(id)->getHandle();
+}
+
+template <class C>
+void EntityManager::markChanged(ID id)
+{
+    static_assert(std::is_base_of<Components::Component, C>::value,
+                  "Can only mark components of a type derived from class Components::Component");
+
+    if (!isAlive(id))
     {
-        // should this use move semantics?
-        basePtr = componentsMap.at(typeid(T));
+        throw Exceptions::NoSuchEntity(id);
     }
-    catch (std::out_of_range)
+    if (!stampChanged(id, TypeIds<Components::Component>::get<C>()))
     {
-        throw Exceptions::NoSuchComponent(uuid, typeid(T));
+        throw Exceptions::NoSuchComponent(id, typeid(C));
     }
+    noteChanged(id);
+}
+
+template <class... Cs>
+View<Cs...> EntityManager::view()
+{
+    View<Cs...> view;
+    forEachArchetype<Cs...>(
+        [&view](Archetype *archetype, const unsigned (&columns)[sizeof...(Cs)])
+            { view.addMatch(archetype, columns); },
+        false);
+    return view;
+}
 
-    // Make sure the pointer isn't null
-    if (!basePtr)
+template <class... Cs, class F>
+void EntityManager::each(F fn)
+{
+    forEachArchetype<Cs...>(
+        [&fn](Archetype *archetype, const unsigned (&columns)[sizeof...(Cs)])
+        {
+            View<Cs...>::eachIn(archetype, columns, fn);
+        },
+        true);
+}
+
+template <class... Cs, class F>
+void EntityManager::eachChanged(Archetype::Version since, F fn)
+{
+    forEachArchetype<Cs...>(
+        [since, &fn](Archetype *archetype,
+                     const unsigned (&columns)[sizeof...(Cs)])
+        {
+            View<Cs...>::eachChangedIn(archetype, columns, since, fn);
+        },
+        true);
+}
+
+template <class... Cs>
+Query<Cs...> &EntityManager::query()
+{
+    auto id = TypeIds<QueryBase>::get<Query<Cs...>>();
+    if (id >= _queries.size()) _queries.resize(id + 1);
+
+    auto &query = _queries[id];
+    if (!query)
     {
-        LOG_DEBUG << "component " << boost::core::demangle(typeid(T).name())
-                  << " belonging to entity " << uuid << " is null";
-        throw Exceptions::NoSuchComponent(uuid, typeid(T));
+        query.reset(new Query<Cs...>());
+        for (auto &pair : _archetypes)
+        {
+            query->match(pair.second.get());
+        }
     }
+    return static_cast<Query<Cs...> &>(*query);
+}
 
-    // Cast to the proper derived type
-    T *ptr = dynamic_cast<T*>(basePtr);
-    if (!ptr)
+template <class... Cs, class F>
+void EntityManager::forEachArchetype(F fn, bool skipEmpty)
+{
+    static_assert(sizeof...(Cs) > 0, "need at least one component type");
+    static_assert(std::conjunction<
+                      std::is_base_of<Components::Component, Cs>...>::value,
+                  "Can only query types derived from class Components::Component");
+
+    const unsigned types[] = { TypeIds<Components::Component>::get<Cs>()... };
+
+    // Drive from the smallest set of candidate archetypes
+    const std::vector<Archetype *> *smallest = nullptr;
+    for (auto type : types)
     {
-        LOG_DEBUG << "could not cast component from Components::Base to "
-                  << boost::core::demangle(typeid(T).name()) << " in entity "
-                  << uuid;
-        throw Exceptions::NoSuchComponent(uuid, typeid(T));
+        if (type >= _archetypesWith.size()) return;
+
+        auto &candidates = _archetypesWith[type];
+        if (!smallest || candidates.size() < smallest->size())
+        {
+            smallest = &candidates;
+        }
     }
 
-    return ptr;
+    unsigned columns[sizeof...(Cs)];
+    for (auto archetype : *smallest)
+    {
+        if (skipEmpty && !archetype->getSize()) continue;
+
+        bool matches = true;
+        for (std::size_t i = 0; i < sizeof...(Cs) && matches; i++)
+        {
+            columns[i] = archetype->getColumn(types[i]);
+            matches = columns[i] != Archetype::NO_COLUMN;
+        }
+
+        if (matches) fn(archetype, columns);
+    }
 }
 
 #endif
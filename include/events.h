@@ -26,12 +26,13 @@
 #include <list>
 #include <memory>
 #include <sstream>
-#include <typeindex>
 #include <typeinfo>
-#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "framearena.h"
 #include "stringable.h"
+#include "typeids.h"
 
 #ifdef _DEBUG
 #   define _DEBUG_EVENTS
@@ -170,12 +171,13 @@ private:
     typedef std::function<void(const Event &)> SubscriberCallback;
     typedef std::pair<Subscriber *, SubscriberCallback> SubscriberPair;
     typedef std::list<SubscriberPair> SubscriberList;
-    typedef std::unordered_map<std::type_index, SubscriberList> TypeSubscriberMap;
+    // Indexed by event type ID, see TypeIds
+    typedef std::vector<SubscriberList> TypeSubscriberMap;
 
     typedef std::function<void(std::shared_ptr<Event>)> AsyncSubscriberCallback;
     typedef std::pair<AsyncSubscriber *, AsyncSubscriberCallback> AsyncSubscriberPair;
     typedef std::list<AsyncSubscriberPair> AsyncSubscriberList;
-    typedef std::unordered_map<std::type_index, AsyncSubscriberList> TypeAsyncSubscriberMap;
+    typedef std::vector<AsyncSubscriberList> TypeAsyncSubscriberMap;
 
     static TypeSubscriberMap _map;
     static TypeAsyncSubscriberMap _asyncMap;
@@ -187,7 +189,23 @@ void Dispatcher::raise(Args&& ... args)
     static_assert(std::is_base_of<Event, E>::value,
                   "Can only raise types derived from class Events::Base");
 
-    auto event = std::make_shared<E>(std::forward<Args>(args)...);
+    // Events that only go to synchronous subscribers are dead by the time
+    // raise() returns, so they can live in this thread's frame arena.
+    // Asynchronous subscribers may hang on to them, so those get the heap
+    auto id = TypeIds<Event>::get<E>();
+    bool hasAsync = id < _asyncMap.size() && !_asyncMap[id].empty();
+
+    std::shared_ptr<E> event;
+    auto arena = FrameArena::getCurrent();
+    if (arena && !hasAsync)
+    {
+        event = std::allocate_shared<E>(FrameAllocator<E>(*arena),
+                                        std::forward<Args>(args)...);
+    }
+    else
+    {
+        event = std::make_shared<E>(std::forward<Args>(args)...);
+    }
     auto baseEvent = std::static_pointer_cast<Event>(event);
 
 #ifdef _DEBUG_EVENTS
@@ -198,17 +216,23 @@ void Dispatcher::raise(Args&& ... args)
 #endif
 
     // First, queue it for asynchronous subscribers
-    auto asyncList = _asyncMap[typeid(E)];
-    for (auto &pair : asyncList)
+    if (hasAsync)
     {
-        pair.second(baseEvent);
+        auto asyncList = _asyncMap[id];
+        for (auto &pair : asyncList)
+        {
+            pair.second(baseEvent);
+        }
     }
 
     // Next, fire off regular subscribers
-    auto list = _map[typeid(E)];
-    for (auto &pair : list)
+    if (id < _map.size())
     {
-        pair.second(*baseEvent);
+        auto list = _map[id];
+        for (auto &pair : list)
+        {
+            pair.second(*baseEvent);
+        }
     }
 }
 
@@ -218,7 +242,9 @@ void Dispatcher::subscribeSync(T &subscriber)
     auto callback = [&subscriber](const Event &event)
         { subscriber.onEvent(static_cast<const E &>(event)); };
 
-    _map[typeid(E)].push_back(
+    auto id = TypeIds<Event>::get<E>();
+    if (id >= _map.size()) _map.resize(id + 1);
+    _map[id].push_back(
                 std::make_pair(static_cast<Subscriber *>(&subscriber),
                                callback));
 
@@ -235,7 +261,9 @@ void Dispatcher::subscribeAsync(T &subscriber)
     auto callback = [&subscriber](std::shared_ptr<Event> event)
         { subscriber.queueEvent(std::static_pointer_cast<E>(event)); };
 
-    _asyncMap[typeid(E)].push_back(
+    auto id = TypeIds<Event>::get<E>();
+    if (id >= _asyncMap.size()) _asyncMap.resize(id + 1);
+    _asyncMap[id].push_back(
                 std::make_pair(static_cast<AsyncSubscriber *>(&subscriber),
                                callback));
 
@@ -250,10 +278,10 @@ template <class E, class T>
 void Dispatcher::unsubscribeSync(T &subscriber)
 {
     auto s = static_cast<Subscriber *>(&subscriber);
-    auto i = _map.find(typeid(E));
-    if (i != _map.end())
+    auto id = TypeIds<Event>::get<E>();
+    if (id < _map.size())
     {
-        auto &list = i->second;
+        auto &list = _map[id];
         for (auto j = list.begin(); j != list.end(); j++)
         {
             if (j->first == s)
@@ -275,10 +303,10 @@ template <class E, class T>
 void Dispatcher::unsubscribeAsync(T &subscriber)
 {
     auto s = static_cast<AsyncSubscriber *>(&subscriber);
-    auto i = _asyncMap.find(typeid(E));
-    if (i != _asyncMap.end())
+    auto id = TypeIds<Event>::get<E>();
+    if (id < _asyncMap.size())
     {
-        auto &list = i->second;
+        auto &list = _asyncMap[id];
         for (auto j = list.begin(); j != list.end(); j++)
         {
             if (j->first == s)
@@ -301,9 +329,8 @@ void Dispatcher::unsubscribeSync(T &subscriber)
 {
     auto s = static_cast<Subscriber *>(&subscriber);
 
-    for (auto &i : _map)
+    for (auto &list : _map)
     {
-        auto &list = i.second;
         for (auto j = list.begin(); j != list.end(); j++)
         {
             if (j->first == s)
@@ -325,9 +352,8 @@ void Dispatcher::unsubscribeAsync(T &subscriber)
 {
     auto s = static_cast<AsyncSubscriber *>(&subscriber);
 
-    for (auto &i : _asyncMap)
+    for (auto &list : _asyncMap)
     {
-        auto &list = i.second;
         for (auto j = list.begin(); j != list.end(); j++)
         {
             if (j->first == s)
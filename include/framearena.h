@@ -0,0 +1,145 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_FRAMEARENA_H__
+#define __OGRE_FRAMEARENA_H__
+
+#include "defines.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "stringable.h"
+
+// Bump allocator for data that only lives until the end of the frame.
+// Allocation is a pointer increment, deallocation does nothing, and reset()
+// throws away everything at once. If a frame overflows the current block
+// another is chained on, and on the next reset the blocks are merged into a
+// single one big enough for the whole frame.
+//
+// Not thread-safe; each arena belongs to one thread
+class FrameArena : public Stringable
+{
+public:
+    static constexpr std::size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    FrameArena(std::size_t blockSize = DEFAULT_BLOCK_SIZE);
+    ~FrameArena();
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    void *allocate(std::size_t size,
+                   std::size_t alignment = alignof(std::max_align_t));
+
+    // Releases everything allocated since the last reset
+    void reset();
+
+    // Bytes handed out since the last reset, and per-frame totals
+    inline std::size_t getBytesUsed() const { return _bytesUsed; }
+    inline std::size_t getLastFrameBytes() const { return _lastFrameBytes; }
+    inline std::size_t getPeakFrameBytes() const { return _peakFrameBytes; }
+
+    std::string toString() const override;
+
+    // The arena transient allocations on this thread should go to, if any
+    static FrameArena *getCurrent();
+    static void setCurrent(FrameArena *arena);
+
+private:
+    struct Block
+    {
+        Block *next;
+        std::size_t size;
+    };
+
+    Block *_blocks;
+    unsigned char *_cursor;
+    unsigned char *_limit;
+    std::size_t _blockSize;
+    std::size_t _bytesUsed;
+    std::size_t _lastFrameBytes;
+    std::size_t _peakFrameBytes;
+
+    void *allocateSlow(std::size_t size, std::size_t alignment);
+    void addBlock(std::size_t size);
+    void releaseBlocks();
+};
+
+// STL allocator adaptor over a FrameArena. Containers using it must not
+// outlive the frame they were created in
+template <class T>
+class FrameAllocator
+{
+public:
+    typedef T value_type;
+
+    FrameAllocator(FrameArena &arena) : _arena(&arena) {}
+
+    template <class U>
+    FrameAllocator(const FrameAllocator<U> &other) : _arena(other._arena) {}
+
+    inline T *allocate(std::size_t n)
+    {
+        return static_cast<T *>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    inline void deallocate(T *, std::size_t) {}
+
+    template <class U>
+    inline bool operator==(const FrameAllocator<U> &other) const
+    {
+        return _arena == other._arena;
+    }
+
+    template <class U>
+    inline bool operator!=(const FrameAllocator<U> &other) const
+    {
+        return _arena != other._arena;
+    }
+
+private:
+    template <class U> friend class FrameAllocator;
+
+    FrameArena *_arena;
+};
+
+typedef std::basic_string<char, std::char_traits<char>, FrameAllocator<char>>
+    FrameString;
+
+template <class T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+inline void *FrameArena::allocate(std::size_t size, std::size_t alignment)
+{
+    assert(alignment && !(alignment & (alignment - 1)));
+
+    auto address = reinterpret_cast<std::uintptr_t>(_cursor);
+    auto aligned = (address + alignment - 1) & ~(alignment - 1);
+    auto p = reinterpret_cast<unsigned char *>(aligned);
+
+    if (!_cursor || p + size > _limit) return allocateSlow(size, alignment);
+
+    _cursor = p + size;
+    _bytesUsed += size;
+    return p;
+}
+
+#endif
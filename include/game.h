@@ -23,9 +23,13 @@
 #include <OgreFrameListener.h>
 #include <OgreRoot.h>
 
+#include "autosaver.h"
 #include "entitymanager.h"
 #include "events.h"
+#include "framearena.h"
 #include "inputmanager.h"
+#include "jobsystem.h"
+#include "scheduler.h"
 #include "stringable.h"
 #include "window.h"
 
@@ -41,6 +45,10 @@ public:
         std::string logFile;
         bool suppressOgreLog;
         bool showConfigDialog;
+
+        std::string autosaveFile;
+        // Seconds between autosaves, 0 to turn autosaving off
+        float autosaveInterval;
     };
 
     Game(const Options &options);
@@ -57,6 +65,9 @@ public:
     inline Window *getWindow() const { return _window; }
     inline InputManager *getInputMgr() const { return _inputMgr; }
     inline EntityManager *getEntityMgr() const { return _entityMgr; }
+    inline JobSystem *getJobSystem() const { return _jobSystem; }
+    inline Scheduler *getScheduler() const { return _scheduler; }
+    inline FrameArena &getFrameArena() { return _frameArena; }
     
     void onEvent(const Events::Quit &event);
     
@@ -68,7 +79,14 @@ private:
     bool _running;
     Window *_window;
     InputManager *_inputMgr;
+    JobSystem *_jobSystem;
     EntityManager *_entityMgr;
+    Scheduler *_scheduler;
+    Autosaver *_autosaver;
+    float _autosaveTimer;
+
+    // Scratch memory for the current frame, reset as each frame starts
+    FrameArena _frameArena;
 	
 	// OGRE variables
 	Ogre::Root *_root;
@@ -0,0 +1,89 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_HANDLE_H__
+#define __OGRE_HANDLE_H__
+
+#include "defines.h"
+
+#include <boost/core/demangle.hpp>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+// Cheap, copyable reference to an object in a pool: the slot index plus the
+// generation the slot was on when the handle was issued. Releasing an object
+// bumps its slot's generation, so resolving a stale handle through the pool
+// gives back null rather than whatever got allocated into the slot next.
+//
+// Deliberately not Stringable, to keep it to a single 64-bit word
+template <class T>
+class Handle final
+{
+public:
+    static constexpr std::uint32_t INVALID_INDEX =
+        std::numeric_limits<std::uint32_t>::max();
+
+    Handle() : _index(INVALID_INDEX), _generation(0) {}
+    Handle(std::uint32_t index, std::uint32_t generation) :
+        _index(index), _generation(generation) {}
+
+    inline std::uint32_t getIndex() const { return _index; }
+    inline std::uint32_t getGeneration() const { return _generation; }
+
+    inline bool isNull() const { return _index == INVALID_INDEX; }
+    inline explicit operator bool() const { return !isNull(); }
+
+    // Both halves packed into one integer, e.g. for use as a map key
+    inline std::uint64_t getValue() const
+    {
+        return (static_cast<std::uint64_t>(_generation) << 32) | _index;
+    }
+
+    inline bool operator==(const Handle &other) const
+    {
+        return _index == other._index && _generation == other._generation;
+    }
+
+    inline bool operator!=(const Handle &other) const
+    {
+        return !(*this == other);
+    }
+
+    std::string toString() const
+    {
+        std::ostringstream ss;
+        ss << "Handle<" << boost::core::demangle(typeid(T).name()) << ">"
+           << "[index = " << _index << ", generation = " << _generation << "]";
+        return ss.str();
+    }
+
+private:
+    std::uint32_t _index;
+    std::uint32_t _generation;
+};
+
+template <class T>
+inline std::ostream &operator<<(std::ostream &os, const Handle<T> &handle)
+{
+    os << handle.toString();
+    return os;
+}
+
+#endif
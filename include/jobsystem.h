@@ -0,0 +1,206 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __OGRE_JOBSYSTEM_H__
+#define __OGRE_JOBSYSTEM_H__
+
+#include "defines.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "concurrentpool.h"
+#include "stringable.h"
+#include "workstealingdeque.h"
+
+// Number of jobs that can be queued at once before falling back to the heap
+static constexpr unsigned JOB_POOL_SIZE = 4096;
+
+// Tracks a group of jobs. Pass it to JobSystem::run() with each job, then
+// JobSystem::wait() on it, or have more jobs follow it with
+// JobSystem::runAfter()
+class JobCounter
+{
+    friend class JobSystem;
+
+public:
+    JobCounter() : _count(0) {}
+
+    JobCounter(const JobCounter &) = delete;
+    JobCounter &operator=(const JobCounter &) = delete;
+
+    inline bool isDone() const
+    {
+        return _count.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    // Set in _count alongside the number of jobs while anything's waiting
+    // to run after them, so the counter isn't done until that's queued
+    static constexpr unsigned FOLLOWED = 1u << 31;
+
+    std::atomic<unsigned> _count;
+
+    // Jobs to queue once the count's down, with their own counters
+    boost::mutex _mutex;
+    std::vector<std::pair<std::function<void()>, JobCounter *>> _followers;
+};
+
+// Work-stealing job system. Each worker thread has its own Chase-Lev deque
+// and works newest-first through the jobs it queued itself, stealing the
+// oldest jobs from other workers when it runs dry. The thread that creates
+// the JobSystem is worker 0 and does its share whenever it wait()s. Jobs
+// queued from any other thread go through a shared, locked queue.
+//
+// Jobs mustn't throw. Jobs that are still queued when the JobSystem is
+// destroyed are dropped, so wait on every counter first
+class JobSystem : public Stringable
+{
+public:
+    typedef std::function<void()> Function;
+
+    // threadCount includes the creating thread, 0 means one per core
+    explicit JobSystem(unsigned threadCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // Queues fn to run on some worker. If counter isn't null, it's counted
+    // up now and back down once fn has run
+    void run(Function fn, JobCounter *counter = nullptr);
+
+    // As run(), but fn isn't queued until every job counted by dependency
+    // has finished, or straight away if they already have. Don't add more
+    // jobs to dependency after this, and still wait on it before it goes
+    void runAfter(JobCounter &dependency, Function fn,
+                  JobCounter *counter = nullptr);
+
+    // Runs queued jobs until counter reaches zero
+    void wait(JobCounter &counter);
+
+    // Calls fn(first, last) over [begin, end) in pieces of at most grain
+    // indices, in parallel, and returns when they're all done. A grain of 0
+    // picks one that gives each thread a few pieces
+    template <class F>
+    void parallelFor(std::size_t begin, std::size_t end, std::size_t grain,
+                     F fn);
+
+    inline unsigned getThreadCount() const
+    {
+        return static_cast<unsigned>(_workers.size());
+    }
+
+    // Index of the calling thread in whichever JobSystem it works for, or
+    // NOT_A_WORKER
+    static constexpr unsigned NOT_A_WORKER = ~0u;
+    static unsigned getWorkerIndex();
+
+    std::string toString() const override;
+
+private:
+    struct Job
+    {
+        Function fn;
+        JobCounter *counter;
+        bool pooled;
+    };
+
+    struct Worker
+    {
+        WorkStealingDeque<Job> deque;
+        boost::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    ConcurrentPool<Job, JOB_POOL_SIZE> _jobPool;
+
+    // Jobs from threads that aren't workers
+    boost::mutex _injectedMutex;
+    std::deque<Job *> _injected;
+    std::atomic<std::size_t> _injectedCount;
+
+    // Idle workers sleep until there's something queued
+    std::atomic<std::size_t> _queued;
+    std::atomic<unsigned> _sleepers;
+    boost::mutex _sleepMutex;
+    boost::condition_variable _wake;
+    std::atomic<bool> _stopping;
+
+    // run() for a job that's already been counted
+    void queue(Function fn, JobCounter *counter);
+
+    void workerLoop(unsigned index);
+    Job *findJob(unsigned index);
+    void execute(Job *job);
+    void finish(JobCounter &counter);
+    void releaseJob(Job *job);
+};
+
+template <class F>
+void JobSystem::parallelFor(std::size_t begin, std::size_t end,
+                            std::size_t grain, F fn)
+{
+    if (begin >= end) return;
+
+    auto count = end - begin;
+    if (!grain)
+    {
+        grain = std::max<std::size_t>(1, count / (getThreadCount() * 4));
+    }
+
+    // Not worth the overhead
+    if (count <= grain)
+    {
+        fn(begin, end);
+        return;
+    }
+
+    // Every piece shares this, so each job captures a single pointer and
+    // fits in std::function without a trip to the heap. Pieces are handed
+    // out in whatever order the jobs get run
+    struct Range
+    {
+        F &fn;
+        std::size_t begin, end, grain;
+        std::atomic<std::size_t> next;
+    };
+    Range range{ fn, begin, end, grain, 0 };
+
+    JobCounter counter;
+    for (auto first = begin; first < end; first += grain)
+    {
+        run([&range]
+            {
+                auto first = range.begin + range.grain *
+                    range.next.fetch_add(1, std::memory_order_relaxed);
+                range.fn(first, std::min(range.end, first + range.grain));
+            },
+            &counter);
+    }
+    wait(counter);
+}
+
+#endif
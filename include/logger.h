@@ -23,7 +23,6 @@
 #include <boost/log/sources/global_logger_storage.hpp>
 #include <boost/log/sources/record_ostream.hpp>
 #include <boost/log/sources/severity_logger.hpp>
-#include <OgreLog.h>
 
 // Object tag/property that prevents it from being logged
 namespace Debug
@@ -52,8 +51,8 @@ namespace Logger
         }
     }
 
-    // Init/shutdown
-    void init(const std::string &logFile, bool suppressOgreLog);
+    // Init/shutdown. OGRE's log is hooked up separately, see ogrelog.h
+    void init(const std::string &logFile);
     void destroy();
 
     // Predicate that checks if an object is flagged as "do not log"
@@ -62,17 +61,6 @@ namespace Logger
     {
         return !std::is_base_of<Debug::DoNotLog, T>();
     }
-    
-    // LogListener to connect OGRE's logging system to the main logger
-    class OgreLogListener : public Ogre::LogListener
-    {
-    public:
-        void messageLogged(const Ogre::String &message,
-                           Ogre::LogMessageLevel lml,
-                           bool maskDebug,
-                           const Ogre::String &logName,
-                           bool &skipThisMessage) override;
-    };
 }
 
 BOOST_LOG_GLOBAL_LOGGER(gLog, boost::log::sources::severity_logger_mt<Logger::SeverityType>)
@@ -0,0 +1,45 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_OGRELOG_H__
+#define __OGRE_OGRELOG_H__
+
+#include "defines.h"
+
+#include <OgreLog.h>
+
+#include "logger.h"
+
+namespace Logger
+{
+    // LogListener to connect OGRE's logging system to the main logger
+    class OgreLogListener : public Ogre::LogListener
+    {
+    public:
+        void messageLogged(const Ogre::String &message,
+                           Ogre::LogMessageLevel lml,
+                           bool maskDebug,
+                           const Ogre::String &logName,
+                           bool &skipThisMessage) override;
+    };
+
+    // Creates OGRE's log and forwards everything written to it to the main
+    // logger, unless suppress is set. Call after init()
+    void initOgreLog(bool suppress);
+}
+
+#endif
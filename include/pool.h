@@ -5,18 +5,359 @@
 
 #include <boost/core/demangle.hpp>
 #include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <sstream>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "exceptions.h"
+#include "handle.h"
+#include "poolmemory.h"
+#include "poolregistry.h"
 
 #ifdef _DEBUG
 #   include "logger.h"
 #   define _DEBUG_POOL
 #endif
 
-// Compile-time-sized pool class
-template <class T, unsigned N>
-class Pool
+namespace detail
+{
+    inline unsigned countTrailingZeros(std::uint64_t bits)
+    {
+        assert(bits);
+#if defined(__GNUC__)
+        return __builtin_ctzll(bits);
+#else
+        unsigned n = 0;
+        while (!(bits & 1))
+        {
+            bits >>= 1;
+            n++;
+        }
+        return n;
+#endif
+    }
+
+    inline unsigned floorLog2(unsigned value)
+    {
+        assert(value);
+#if defined(__GNUC__)
+        return 31 - __builtin_clz(value);
+#else
+        unsigned n = 0;
+        while (value >>= 1) n++;
+        return n;
+#endif
+    }
+
+    template <class T, unsigned Options>
+    constexpr std::size_t poolSlotAlignment()
+    {
+        return (Options & PoolOptions::CacheAligned) &&
+                   alignof(T) < CACHE_LINE_SIZE ?
+               CACHE_LINE_SIZE : alignof(T);
+    }
+
+    // A single contiguous block of pool slots. Pool owns exactly one of these,
+    // GrowablePool chains several together. Alongside the slots sits an
+    // occupancy bitmap with one bit per slot, so live objects can be visited
+    // in address order a word's worth of empty slots at a time, and a
+    // generation counter per slot that's bumped whenever the slot is freed
+    template <class T, unsigned Options>
+    class PoolSlab
+    {
+    public:
+        // Slots honour alignof(T), and are padded out to a whole cache line
+        // when asked to be
+        union alignas(poolSlotAlignment<T, Options>()) Slot
+        {
+            T data;
+            Slot *next;
+        };
+
+        static constexpr unsigned BITS_PER_WORD = 64;
+
+        PoolSlab() : _slots(nullptr), _capacity(0), _baseIndex(0) {}
+        ~PoolSlab() { PoolMemory::release(_block); }
+
+        PoolSlab(const PoolSlab &) = delete;
+        PoolSlab &operator=(const PoolSlab &) = delete;
+
+        // Allocates storage for capacity slots and threads them into a free
+        // list ending in next. Returns the head of the new list. baseIndex is
+        // the pool-wide index of the first slot, for handles
+        Slot *create(unsigned capacity, Slot *next, unsigned baseIndex = 0)
+        {
+            assert(!_block.data);
+            assert(capacity > 0);
+
+            _block = PoolMemory::allocate(capacity * sizeof(Slot),
+                                          alignof(Slot),
+                                          Options & PoolOptions::HugePages);
+            _slots = static_cast<Slot *>(_block.data);
+            _capacity = capacity;
+            _baseIndex = baseIndex;
+            _occupancy.reset(new std::uint64_t[getWordCount()]());
+            _generations.reset(new std::uint32_t[capacity]());
+
+            for (unsigned i = 0; i < capacity - 1; i++)
+            {
+                _slots[i].next = &_slots[i + 1];
+            }
+            _slots[capacity - 1].next = next;
+
+            return _slots;
+        }
+
+        inline bool contains(const Slot *slot) const
+        {
+            return slot >= _slots && slot < _slots + _capacity;
+        }
+
+        inline unsigned getCapacity() const { return _capacity; }
+        inline unsigned getBaseIndex() const { return _baseIndex; }
+
+        inline unsigned indexOf(const Slot *slot) const
+        {
+            return static_cast<unsigned>(slot - _slots);
+        }
+
+        inline Slot &at(unsigned index) { return _slots[index]; }
+
+        inline void markLive(const Slot *slot)
+        {
+            auto index = indexOf(slot);
+            _occupancy[index / BITS_PER_WORD] |=
+                std::uint64_t(1) << (index % BITS_PER_WORD);
+        }
+
+        inline void markFree(const Slot *slot)
+        {
+            auto index = indexOf(slot);
+            _occupancy[index / BITS_PER_WORD] &=
+                ~(std::uint64_t(1) << (index % BITS_PER_WORD));
+            _generations[index]++;
+        }
+
+        inline bool isLive(unsigned index) const
+        {
+            return _occupancy[index / BITS_PER_WORD] &
+                   (std::uint64_t(1) << (index % BITS_PER_WORD));
+        }
+
+        inline Handle<T> getHandle(const Slot *slot) const
+        {
+            auto index = indexOf(slot);
+            return Handle<T>(_baseIndex + index, _generations[index]);
+        }
+
+        // Null if the handle is stale or its object has been released
+        inline T *resolve(unsigned index, std::uint32_t generation)
+        {
+            if (index >= _capacity || _generations[index] != generation ||
+                !isLive(index))
+            {
+                return nullptr;
+            }
+            return &_slots[index].data;
+        }
+
+        // Index of the first live slot at or after index, or the capacity if
+        // there isn't one
+        unsigned nextLive(unsigned index) const
+        {
+            if (index >= _capacity) return _capacity;
+
+            auto word = index / BITS_PER_WORD;
+            auto bits = _occupancy[word] &
+                        (~std::uint64_t(0) << (index % BITS_PER_WORD));
+            auto wordCount = getWordCount();
+
+            while (!bits)
+            {
+                if (++word == wordCount) return _capacity;
+                bits = _occupancy[word];
+            }
+
+            return word * BITS_PER_WORD + countTrailingZeros(bits);
+        }
+
+        template <class F>
+        void forEachLive(F &fn)
+        {
+            auto wordCount = getWordCount();
+            for (unsigned word = 0; word < wordCount; word++)
+            {
+                auto bits = _occupancy[word];
+                while (bits)
+                {
+                    auto index = word * BITS_PER_WORD + countTrailingZeros(bits);
+                    bits &= bits - 1;
+                    fn(_slots[index].data);
+                }
+            }
+        }
+
+    private:
+        PoolMemory::Block _block;
+        Slot *_slots;
+        unsigned _capacity;
+        unsigned _baseIndex;
+        std::unique_ptr<std::uint64_t[]> _occupancy;
+        std::unique_ptr<std::uint32_t[]> _generations;
+
+        inline unsigned getWordCount() const
+        {
+            return (_capacity + BITS_PER_WORD - 1) / BITS_PER_WORD;
+        }
+    };
+}
+
+// How spread out a pool's live objects are. The span runs from the first
+// slot to the last live one; every free slot inside it is a hole
+struct PoolFragmentation
+{
+    std::size_t live;
+    std::size_t span;
+
+    PoolFragmentation() : live(0), span(0) {}
+
+    inline std::size_t getHoles() const { return span - live; }
+    inline double getRatio() const
+    {
+        return span ? static_cast<double>(span - live) / span : 0.0;
+    }
+};
+
+// Owners of pooled objects register one of these to be told when compaction
+// moves an object. It's called after the object has been moved to its new
+// address and before the old one is destroyed
+template <class T>
+using PoolRelocationListener = std::function<void(T *from, T *to)>;
+
+namespace detail
+{
+    template <class T, unsigned Options>
+    PoolFragmentation measureFragmentation(PoolSlab<T, Options> *slabs,
+                                           unsigned slabCount)
+    {
+        PoolFragmentation result;
+
+        unsigned base = 0;
+        for (unsigned i = 0; i < slabCount; i++)
+        {
+            auto &slab = slabs[i];
+            for (auto index = slab.nextLive(0); index < slab.getCapacity();
+                 index = slab.nextLive(index + 1))
+            {
+                result.live++;
+                result.span = base + index + 1;
+            }
+            base += slab.getCapacity();
+        }
+
+        return result;
+    }
+
+    // Moves live objects from the back of the pool into free slots at the
+    // front until they form a dense prefix, then rebuilds the free list in
+    // address order so new objects keep filling from the front. Returns the
+    // head of the new free list
+    template <class T, unsigned Options>
+    typename PoolSlab<T, Options>::Slot *compactSlabs(
+            PoolSlab<T, Options> *slabs,
+            unsigned slabCount,
+            const std::vector<std::pair<unsigned, PoolRelocationListener<T>>> &listeners,
+            unsigned &moved)
+    {
+        typedef typename PoolSlab<T, Options>::Slot Slot;
+
+        // Low finger looks for free slots going forwards, high finger for
+        // live ones going backwards
+        unsigned lowSlab = 0, low = 0;
+        unsigned highSlab = slabCount - 1, high = slabs[highSlab].getCapacity();
+
+        moved = 0;
+        for (;;)
+        {
+            while (lowSlab < slabCount &&
+                   (low == slabs[lowSlab].getCapacity() ||
+                    slabs[lowSlab].isLive(low)))
+            {
+                if (low == slabs[lowSlab].getCapacity())
+                {
+                    lowSlab++;
+                    low = 0;
+                }
+                else
+                {
+                    low++;
+                }
+            }
+
+            while (high == 0 || !slabs[highSlab].isLive(high - 1))
+            {
+                if (high == 0)
+                {
+                    if (highSlab == 0) break;
+                    high = slabs[--highSlab].getCapacity();
+                }
+                else
+                {
+                    high--;
+                }
+            }
+
+            // Done once the fingers cross
+            if (lowSlab == slabCount || high == 0) break;
+            if (lowSlab > highSlab || (lowSlab == highSlab && low >= high - 1))
+            {
+                break;
+            }
+
+            auto &from = slabs[highSlab].at(high - 1);
+            auto &to = slabs[lowSlab].at(low);
+
+            new (&to.data) T(std::move(from.data));
+            for (auto &listener : listeners)
+            {
+                listener.second(&from.data, &to.data);
+            }
+            from.data.~T();
+
+            slabs[lowSlab].markLive(&to);
+            slabs[highSlab].markFree(&from);
+            moved++;
+        }
+
+        // Thread the free list back together, lowest address first
+        Slot *head = nullptr;
+        for (unsigned i = slabCount; i-- > 0; )
+        {
+            auto &slab = slabs[i];
+            for (unsigned index = slab.getCapacity(); index-- > 0; )
+            {
+                if (!slab.isLive(index))
+                {
+                    slab.at(index).next = head;
+                    head = &slab.at(index);
+                }
+            }
+        }
+
+        return head;
+    }
+}
+
+// Compile-time-sized pool class. Options is a combination of PoolOptions
+template <class T, unsigned N, unsigned Options = PoolOptions::Default>
+class Pool : public PoolBase
 {
 public:
     Pool();
@@ -27,23 +368,166 @@ public:
 
     void release(T *object) noexcept;
 
+    inline unsigned getCapacity() const { return N; }
+
+    PoolStats getStats() const override { return _stats; }
+
+    // Generational handles to live objects. resolve() gives back null for a
+    // stale handle, in constant time
+    Handle<T> getHandle(const T *object) const;
+    T *resolve(Handle<T> handle);
+
+    // Visits every live object in address order
+    template <class F>
+    void forEach(F fn) { _slab.forEachLive(fn); }
+
+    class iterator;
+    iterator begin() { return iterator(&_slab, _slab.nextLive(0)); }
+    iterator end() { return iterator(&_slab, N); }
+
+    // Opt-in defragmentation, for loading screens and idle frames. Moves live
+    // objects down into a dense prefix by move construction, telling every
+    // relocation listener about each move, and returns how many were moved.
+    // Handles to moved objects go stale
+    unsigned compact();
+    PoolFragmentation getFragmentation();
+
+    unsigned addRelocationListener(PoolRelocationListener<T> listener);
+    void removeRelocationListener(unsigned id);
+
+private:
+    typedef detail::PoolSlab<T, Options> Slab;
+    typedef typename Slab::Slot PoolObject;
+
+    Slab _slab;
+    PoolObject *_freeListHead;
+    PoolStats _stats;
+
+    std::vector<std::pair<unsigned, PoolRelocationListener<T>>>
+        _relocationListeners;
+    unsigned _nextListenerId;
+};
+
+// Forward iterator over the live objects in a Pool, in address order
+template <class T, unsigned N, unsigned Options>
+class Pool<T, N, Options>::iterator
+{
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T *pointer;
+    typedef T &reference;
+
+    iterator(Slab *slab, unsigned index) : _slab(slab), _index(index) {}
+
+    inline T &operator*() const { return _slab->at(_index).data; }
+    inline T *operator->() const { return &_slab->at(_index).data; }
+
+    inline iterator &operator++()
+    {
+        _index = _slab->nextLive(_index + 1);
+        return *this;
+    }
+
+    inline iterator operator++(int)
+    {
+        iterator old = *this;
+        ++*this;
+        return old;
+    }
+
+    inline bool operator==(const iterator &other) const
+    {
+        return _index == other._index;
+    }
+
+    inline bool operator!=(const iterator &other) const
+    {
+        return _index != other._index;
+    }
+
 private:
-    union PoolObject
+    Slab *_slab;
+    unsigned _index;
+};
+
+// Pool that starts out with a slab of N objects and chains on additional
+// slabs as it runs dry, each one doubling the total capacity. Live
+// objects are never moved unless compact() is called. MaxCapacity caps the
+// total number of objects the pool will hold (zero means no cap)
+template <class T, unsigned N, unsigned MaxCapacity = 0,
+          unsigned Options = PoolOptions::Default>
+class GrowablePool : public PoolBase
+{
+public:
+    GrowablePool();
+    ~GrowablePool();
+
+    template <class U = T>
+    U *allocate();
+
+    void release(T *object) noexcept;
+
+    inline unsigned getCapacity() const { return _capacity; }
+    inline unsigned getSlabCount() const { return _slabCount; }
+
+    PoolStats getStats() const override { return _stats; }
+
+    // Generational handles to live objects, as for Pool. Resolving works out
+    // the slab from the index, since slab sizes double
+    Handle<T> getHandle(const T *object) const;
+    T *resolve(Handle<T> handle);
+
+    // Visits every live object, slab by slab and in address order within
+    // each slab
+    template <class F>
+    void forEach(F fn)
     {
-        T data;
-        PoolObject *next;
-    };
+        for (unsigned i = 0; i < _slabCount; i++)
+        {
+            _slabs[i].forEachLive(fn);
+        }
+    }
+
+    // Opt-in defragmentation, as for Pool. Objects are packed towards the
+    // start of the first slab
+    unsigned compact();
+    PoolFragmentation getFragmentation();
+
+    unsigned addRelocationListener(PoolRelocationListener<T> listener);
+    void removeRelocationListener(unsigned id);
 
-    unsigned char *_rawPool;
-    PoolObject *_pool;
+private:
+    typedef detail::PoolSlab<T, Options> Slab;
+    typedef typename Slab::Slot PoolObject;
+
+    // Doubling from N, 32 slabs is more than an unsigned capacity can hold
+    static constexpr unsigned MAX_SLABS = 32;
+
+    Slab _slabs[MAX_SLABS];
+    unsigned _slabCount;
+    unsigned _capacity;
     PoolObject *_freeListHead;
+    PoolStats _stats;
+
+    std::vector<std::pair<unsigned, PoolRelocationListener<T>>>
+        _relocationListeners;
+    unsigned _nextListenerId;
+
+    unsigned findSlab(const PoolObject *object) const;
+    bool grow();
 };
 
-// Simple poolable object that overrides operators new and delete
-template <class T, unsigned N>
+// Simple poolable object that overrides operators new and delete. The backing
+// pool defaults to a fixed-size Pool; pass a GrowablePool for types whose
+// population can't be bounded at compile time
+template <class T, unsigned N, class P = Pool<T, N>>
 class PoolableObject
 {
 public:
+    typedef P PoolType;
+
     static void *operator new(std::size_t sz)
     {
         void *p = getPool().allocate();  
@@ -74,10 +558,48 @@ public:
 #endif
     }
 
+    static PoolStats getPoolStats()
+    {
+        return getPool().getStats();
+    }
+
+    static Handle<T> getHandle(const T *object)
+    {
+        return getPool().getHandle(object);
+    }
+
+    static T *resolve(Handle<T> handle)
+    {
+        return getPool().resolve(handle);
+    }
+
+    // Visits every live instance of T
+    template <class F>
+    static void forEachInstance(F fn)
+    {
+        getPool().forEach([&fn](T &object) { fn(object); });
+    }
+
+    // Defragments the pool behind T, see Pool::compact()
+    static unsigned compactPool()
+    {
+        return getPool().compact();
+    }
+
+    static unsigned addRelocationListener(PoolRelocationListener<T> listener)
+    {
+        return getPool().addRelocationListener(std::move(listener));
+    }
+
+    static void removeRelocationListener(unsigned id)
+    {
+        getPool().removeRelocationListener(id);
+    }
+
 protected:
-    static Pool<T, N> &getPool()
+    static PoolType &getPool()
     {
-        static Pool<T, N> pool;
+        static PoolType pool;
         return pool;
     }
 };
@@ -100,37 +622,30 @@ namespace Exceptions
     };
 }
 
-template <class T, unsigned N>
-Pool<T, N>::Pool() :
-    _rawPool(nullptr),
-    _pool(nullptr),
-    _freeListHead(nullptr)
+template <class T, unsigned N, unsigned Options>
+Pool<T, N, Options>::Pool() :
+    PoolBase(typeid(T), "Pool"),
+    _freeListHead(nullptr),
+    _nextListenerId(0)
 {
     static_assert(N > 0,
                   "pool capacity must be greater than zero");
 
-    // Allocate a raw chunk of bytes for memory
-    _rawPool = new unsigned char[N * sizeof(PoolObject)];
-    _pool = reinterpret_cast<PoolObject *>(_rawPool);
+    // Allocate a raw chunk of bytes for memory and initialize the free list
+    _freeListHead = _slab.create(N, nullptr);
+    _stats.capacity = N;
 
-    // Initialize the free list
-    _freeListHead = _pool;
-    for (unsigned i = 0; i < N - 1; i++)
-    {
-        _pool[i].next = &_pool[i + 1];
-    }
-    _pool[N - 1].next = nullptr;
+    registerPool();
 }
 
-template <class T, unsigned N>
-Pool<T, N>::~Pool()
+template <class T, unsigned N, unsigned Options>
+Pool<T, N, Options>::~Pool()
 {
-    assert(_rawPool);
-    delete[] _rawPool;
+    unregisterPool();
 }
 
-template <class T, unsigned N> template <class U>
-U *Pool<T, N>::allocate()
+template <class T, unsigned N, unsigned Options> template <class U>
+U *Pool<T, N, Options>::allocate()
 {
     static_assert(std::is_base_of<T, U>::value,
                   "can only allocate objects of or subclassed from pool base type");
@@ -138,28 +653,303 @@ U *Pool<T, N>::allocate()
                   "can only allocate subclasses of identical size to pool base type");
 
     // If free list is empty, nothing left to allocate
-    if (!_freeListHead) throw Exceptions::PoolOutOfMemory(typeid(T));
+    if (!_freeListHead)
+    {
+        _stats.failures++;
+        throw Exceptions::PoolOutOfMemory(typeid(T));
+    }
 
     // Pop an entry off the free list
     U *object = reinterpret_cast<U *>(&_freeListHead->data);
+    _slab.markLive(_freeListHead);
     _freeListHead = _freeListHead->next;
+
+    _stats.allocations++;
+    if (++_stats.live > _stats.peak) _stats.peak = _stats.live;
+
     return object;
 }
 
-template <class T, unsigned N>
-void Pool<T, N>::release(T *object) noexcept
+template <class T, unsigned N, unsigned Options>
+void Pool<T, N, Options>::release(T *object) noexcept
 {
     assert(object);
 
     PoolObject *poolObject = reinterpret_cast<PoolObject *>(object);
+    assert(_slab.contains(poolObject));
+    _slab.markFree(poolObject);
+
+    // Add entry to free list
+    PoolObject *oldHead = _freeListHead;
+    _freeListHead = poolObject;
+    poolObject->next = oldHead;
+
+    _stats.releases++;
+    _stats.live--;
+}
+
+template <class T, unsigned N, unsigned Options>
+Handle<T> Pool<T, N, Options>::getHandle(const T *object) const
+{
+    assert(object);
+
+    auto poolObject = reinterpret_cast<const PoolObject *>(object);
+    assert(_slab.contains(poolObject));
+    return _slab.getHandle(poolObject);
+}
+
+template <class T, unsigned N, unsigned Options>
+T *Pool<T, N, Options>::resolve(Handle<T> handle)
+{
+    return _slab.resolve(handle.getIndex(), handle.getGeneration());
+}
+
+template <class T, unsigned N, unsigned Options>
+unsigned Pool<T, N, Options>::compact()
+{
+    static_assert(!std::is_polymorphic<T>::value || std::is_final<T>::value,
+                  "can't compact a pool whose objects might be subclasses");
+    static_assert(std::is_move_constructible<T>::value,
+                  "can only compact pools of move-constructible types");
+
+#ifdef _DEBUG_POOL
+    auto before = getFragmentation();
+#endif
+
+    unsigned moved;
+    _freeListHead = detail::compactSlabs(&_slab, 1, _relocationListeners, moved);
+
+#ifdef _DEBUG_POOL
+    auto after = getFragmentation();
+    LOG_DEBUG << "compacted pool of type "
+              << boost::core::demangle(typeid(T).name()) << ", moved "
+              << moved << " objects, holes " << before.getHoles()
+              << " -> " << after.getHoles();
+#endif
+
+    return moved;
+}
+
+template <class T, unsigned N, unsigned Options>
+PoolFragmentation Pool<T, N, Options>::getFragmentation()
+{
+    return detail::measureFragmentation(&_slab, 1);
+}
+
+template <class T, unsigned N, unsigned Options>
+unsigned Pool<T, N, Options>::addRelocationListener(
+        PoolRelocationListener<T> listener)
+{
+    auto id = _nextListenerId++;
+    _relocationListeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+template <class T, unsigned N, unsigned Options>
+void Pool<T, N, Options>::removeRelocationListener(unsigned id)
+{
+    for (auto i = _relocationListeners.begin();
+         i != _relocationListeners.end(); i++)
+    {
+        if (i->first == id)
+        {
+            _relocationListeners.erase(i);
+            break;
+        }
+    }
+}
+
+template <class T, unsigned N, unsigned MaxCapacity, unsigned Options>
+GrowablePool<T, N, MaxCapacity, Options>::GrowablePool() :
+    PoolBase(typeid(T), "GrowablePool"),
+    _slabCount(0),
+    _capacity(0),
+    _freeListHead(nullptr),
+    _nextListenerId(0)
+{
+    static_assert(N > 0,
+                  "pool capacity must be greater than zero");
+    static_assert(MaxCapacity == 0 || MaxCapacity >= N,
+                  "maximum pool capacity must be at least the initial capacity");
+
+    grow();
+    registerPool();
+}
+
+template <class T, unsigned N, unsigned MaxCapacity, unsigned Options>
+GrowablePool<T, N, MaxCapacity, Options>::~GrowablePool()
+{
+    unregisterPool();
+}
+
+template <class T, unsigned N, unsigned MaxCapacity, unsigned Options>
+template <class U>
+U *GrowablePool<T, N, MaxCapacity, Options>::allocate()
+{
+    static_assert(std::is_base_of<T, U>::value,
+                  "can only allocate objects of or subclassed from pool base type");
+    static_assert(sizeof(T) == sizeof(U),
+                  "can only allocate subclasses of identical size to pool base type");
+
+    // If free list is empty, chain on another slab before giving up
+    if (!_freeListHead && !grow())
+    {
+        _stats.failures++;
+        throw Exceptions::PoolOutOfMemory(typeid(T));
+    }
+
+    // Pop an entry off the free list
+    U *object = reinterpret_cast<U *>(&_freeListHead->data);
+    _slabs[findSlab(_freeListHead)].markLive(_freeListHead);
+    _freeListHead = _freeListHead->next;
+
+    _stats.allocations++;
+    if (++_stats.live > _stats.peak) _stats.peak = _stats.live;
+
+    return object;
+}
+
+template <class T, unsigned N, unsigned MaxCapacity, unsigned Options>
+void GrowablePool<T, N, MaxCapacity, Options>::release(T *object) noexcept
+{
+    assert(object);
 
-    assert(poolObject >= _pool);
-    assert(poolObject <= (_pool + sizeof(PoolObject) * (N - 1)));
+    PoolObject *poolObject = reinterpret_cast<PoolObject *>(object);
+    _slabs[findSlab(poolObject)].markFree(poolObject);
 
     // Add entry to free list
     PoolObject *oldHead = _freeListHead;
     _freeListHead = poolObject;
     poolObject->next = oldHead;
+
+    _stats.releases++;
+    _stats.live--;
+}
+
+template <class T, unsigned N, unsigned MaxCapacity, unsigned Options>
+unsigned GrowablePool<T, N, MaxCapacity, Options>::findSlab(
+        const PoolObject *object) const
+{
+    // Later slabs are bigger and hold most of the objects, so start there.
+    // There are never more than MAX_SLABS of them
+    for (unsigned i = _slabCount; i-- > 0; )
+    {
+        if (_slabs[i].contains(object)) return i;
+    }
+
+    assert(!"object does not belong to this pool");
+    return 0;
+}
+
+template <class T, unsigned N, unsigned MaxCapacity, unsigned Options>
+Handle<T> GrowablePool<T, N, MaxCapacity, Options>::getHandle(
+        const T *object) const
+{
+    assert(object);
+
+    auto poolObject = reinterpret_cast<const PoolObject *>(object);
+    return _slabs[findSlab(poolObject)].getHandle(poolObject);
+}
+
+template <class T, unsigned N, unsigned MaxCapacity, unsigned Options>
+T *GrowablePool<T, N, MaxCapacity, Options>::resolve(Handle<T> handle)
+{
+    auto index = handle.getIndex();
+    if (index >= _capacity) return nullptr;
+
+    // Slab k > 0 starts at index N << (k - 1)
+    auto slab = index < N ? 0 : detail::floorLog2(index / N) + 1;
+    assert(slab < _slabCount);
+
+    return _slabs[slab].resolve(index - _slabs[slab].getBaseIndex(),
+                                handle.getGeneration());
+}
+
+template <class T, unsigned N, unsigned MaxCapacity, unsigned Options>
+unsigned GrowablePool<T, N, MaxCapacity, Options>::compact()
+{
+    static_assert(!std::is_polymorphic<T>::value || std::is_final<T>::value,
+                  "can't compact a pool whose objects might be subclasses");
+    static_assert(std::is_move_constructible<T>::value,
+                  "can only compact pools of move-constructible types");
+
+#ifdef _DEBUG_POOL
+    auto before = getFragmentation();
+#endif
+
+    unsigned moved;
+    _freeListHead = detail::compactSlabs(_slabs, _slabCount,
+                                         _relocationListeners, moved);
+
+#ifdef _DEBUG_POOL
+    auto after = getFragmentation();
+    LOG_DEBUG << "compacted pool of type "
+              << boost::core::demangle(typeid(T).name()) << ", moved "
+              << moved << " objects, holes " << before.getHoles()
+              << " -> " << after.getHoles();
+#endif
+
+    return moved;
+}
+
+template <class T, unsigned N, unsigned MaxCapacity, unsigned Options>
+PoolFragmentation GrowablePool<T, N, MaxCapacity, Options>::getFragmentation()
+{
+    return detail::measureFragmentation(_slabs, _slabCount);
+}
+
+template <class T, unsigned N, unsigned MaxCapacity, unsigned Options>
+unsigned GrowablePool<T, N, MaxCapacity, Options>::addRelocationListener(
+        PoolRelocationListener<T> listener)
+{
+    auto id = _nextListenerId++;
+    _relocationListeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+template <class T, unsigned N, unsigned MaxCapacity, unsigned Options>
+void GrowablePool<T, N, MaxCapacity, Options>::removeRelocationListener(unsigned id)
+{
+    for (auto i = _relocationListeners.begin();
+         i != _relocationListeners.end(); i++)
+    {
+        if (i->first == id)
+        {
+            _relocationListeners.erase(i);
+            break;
+        }
+    }
+}
+
+template <class T, unsigned N, unsigned MaxCapacity, unsigned Options>
+bool GrowablePool<T, N, MaxCapacity, Options>::grow()
+{
+    if (_slabCount == MAX_SLABS) return false;
+    if (_capacity > std::numeric_limits<unsigned>::max() / 2) return false;
+
+    // Each new slab doubles the total capacity, up to the cap
+    unsigned slabCapacity = _slabCount ? _capacity : N;
+    if (MaxCapacity)
+    {
+        if (_capacity >= MaxCapacity) return false;
+        if (slabCapacity > MaxCapacity - _capacity)
+        {
+            slabCapacity = MaxCapacity - _capacity;
+        }
+    }
+
+    _freeListHead = _slabs[_slabCount++].create(slabCapacity, _freeListHead,
+                                                 _capacity);
+    _capacity += slabCapacity;
+    _stats.capacity = _capacity;
+
+#ifdef _DEBUG_POOL
+    LOG_DEBUG << "pool of type " << boost::core::demangle(typeid(T).name())
+              << " grew to " << _capacity << " objects in "
+              << _slabCount << " slabs";
+#endif
+
+    return true;
 }
 
 #endif
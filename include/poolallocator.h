@@ -0,0 +1,120 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_POOLALLOCATOR_H__
+#define __OGRE_POOLALLOCATOR_H__
+
+#include "defines.h"
+
+#include <cstddef>
+
+#include "pool.h"
+#include "sizeclasspool.h"
+
+// Opaque block with the size and alignment of some node type
+template <std::size_t Size, std::size_t Align>
+struct alignas(Align) PoolAllocatorBlock
+{
+    unsigned char bytes[Size];
+};
+
+namespace detail
+{
+    // Shared by every PoolAllocator node type with the same layout and N
+    template <std::size_t Size, std::size_t Align, unsigned N>
+    GrowablePool<PoolAllocatorBlock<Size, Align>, N> &getPoolAllocatorNodes()
+    {
+        static GrowablePool<PoolAllocatorBlock<Size, Align>, N> pool;
+        return pool;
+    }
+
+    // Shared by every PoolAllocator with the same N, whatever its type
+    template <unsigned N>
+    SizeClassPool<N> &getPoolAllocatorArrays()
+    {
+        static SizeClassPool<N> pool;
+        return pool;
+    }
+}
+
+// Stateless STL allocator for node-based containers. Single-object
+// allocations, which is every node of a list, set or map, come from a
+// GrowablePool shared by all types of the same size and alignment. Arrays,
+// such as hash table bucket arrays, go through a SizeClassPool, and from
+// there to the heap if they're large.
+//
+// Like the pools underneath it, this isn't thread-safe. The pools are
+// function-local statics, so containers using this mustn't have static
+// storage duration themselves
+template <class T, unsigned N = 256>
+class PoolAllocator
+{
+public:
+    typedef T value_type;
+
+    template <class U>
+    struct rebind
+    {
+        typedef PoolAllocator<U, N> other;
+    };
+
+    PoolAllocator() {}
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U, N> &) {}
+
+    T *allocate(std::size_t n)
+    {
+        if (n == 1)
+        {
+            return reinterpret_cast<T *>(getNodePool().allocate());
+        }
+        return static_cast<T *>(
+            detail::getPoolAllocatorArrays<N>().allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept
+    {
+        if (n == 1)
+        {
+            getNodePool().release(reinterpret_cast<Node *>(p));
+        }
+        else
+        {
+            detail::getPoolAllocatorArrays<N>().release(p, n * sizeof(T));
+        }
+    }
+
+    template <class U>
+    inline bool operator==(const PoolAllocator<U, N> &) const { return true; }
+
+    template <class U>
+    inline bool operator!=(const PoolAllocator<U, N> &) const { return false; }
+
+private:
+    typedef PoolAllocatorBlock<sizeof(T), alignof(T)> Node;
+
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "over-aligned types aren't supported by PoolAllocator");
+
+    static inline GrowablePool<Node, N> &getNodePool()
+    {
+        return detail::getPoolAllocatorNodes<sizeof(T), alignof(T), N>();
+    }
+};
+
+#endif
@@ -0,0 +1,75 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_POOLMEMORY_H__
+#define __OGRE_POOLMEMORY_H__
+
+#include "defines.h"
+
+#include <cstddef>
+
+// Storage options for pools, combined with |
+namespace PoolOptions
+{
+    enum : unsigned
+    {
+        Default      = 0,
+
+        // Pad and align every slot to a cache line, so objects used by
+        // different threads never share one
+        CacheAligned = 1 << 0,
+
+        // Back the pool with huge pages if it's big enough to fill one and
+        // the OS will give us some, falling back to regular pages otherwise
+        HugePages    = 1 << 1
+    };
+}
+
+static constexpr std::size_t CACHE_LINE_SIZE = 64;
+static constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// Raw, aligned backing storage for pools
+namespace PoolMemory
+{
+    enum class Source
+    {
+        None,
+        Heap,
+        Pages,
+        HugePages
+    };
+
+    struct Block
+    {
+        void *data;
+        std::size_t size;
+        std::size_t alignment;
+        Source source;
+
+        Block() :
+            data(nullptr),
+            size(0),
+            alignment(0),
+            source(Source::None) {}
+    };
+
+    // Throws std::bad_alloc on failure
+    Block allocate(std::size_t size, std::size_t alignment, bool hugePages);
+    void release(Block &block) noexcept;
+}
+
+#endif
@@ -0,0 +1,109 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_POOLREGISTRY_H__
+#define __OGRE_POOLREGISTRY_H__
+
+#include "defines.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "stringable.h"
+
+// Usage counters kept by every pool
+struct PoolStats
+{
+    std::size_t capacity;
+    std::size_t live;
+    std::size_t peak;
+    std::uint64_t allocations;
+    std::uint64_t releases;
+    std::uint64_t failures;
+
+    PoolStats() :
+        capacity(0),
+        live(0),
+        peak(0),
+        allocations(0),
+        releases(0),
+        failures(0) {}
+};
+
+// Common base for all pool types. Concrete pools register with PoolRegistry
+// for as long as they're alive, so stats can be queried without knowing the
+// pool's concrete type. Nothing here is on the allocate/release path
+class PoolBase : public Stringable
+{
+protected:
+    PoolBase(const std::type_info &type, const char *kind);
+
+    // Concrete pools call these last thing in their constructor and first
+    // thing in their destructor. Doing it from here instead would let another
+    // thread call getStats() on a pool that's only partly built, or partly
+    // torn down
+    void registerPool();
+    void unregisterPool();
+
+public:
+    virtual ~PoolBase();
+
+    PoolBase(const PoolBase &) = delete;
+    PoolBase &operator=(const PoolBase &) = delete;
+
+    virtual PoolStats getStats() const = 0;
+
+    inline const std::string &getTypeName() const { return _typeName; }
+    inline const char *getKind() const { return _kind; }
+
+    std::string toString() const override;
+
+private:
+    std::string _typeName;
+    const char *_kind;
+    bool _registered;
+};
+
+namespace PoolRegistry
+{
+    struct Entry
+    {
+        std::string typeName;
+        const char *kind;
+        PoolStats stats;
+    };
+
+    // Point-in-time stats for every live pool, ordered by type name
+    std::vector<Entry> snapshot();
+
+    // Logs the stats of every live pool
+    void dump();
+
+    // Logs a warning for every pool that still has objects allocated out of
+    // it, returning how many objects that is in total. Meant for shutdown,
+    // once everything should have been released
+    std::size_t reportLeaks();
+
+    // Called by PoolBase
+    void add(const PoolBase *pool);
+    void remove(const PoolBase *pool);
+}
+
+#endif
@@ -0,0 +1,86 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __OGRE_QUERY_H__
+#define __OGRE_QUERY_H__
+
+#include "defines.h"
+
+#include <cstddef>
+
+#include "archetype.h"
+#include "typeids.h"
+#include "view.h"
+
+// Type-erased base so EntityManager can keep all its queries together
+class QueryBase
+{
+    friend class EntityManager;
+
+public:
+    virtual ~QueryBase() {}
+
+protected:
+    QueryBase() {}
+
+    // Called with each archetype as it's created
+    virtual void match(Archetype *archetype) = 0;
+};
+
+// A View that EntityManager keeps up to date, see EntityManager::query
+template <class... Cs>
+class Query final : public QueryBase
+{
+    friend class EntityManager;
+
+public:
+    static constexpr std::size_t COUNT = sizeof...(Cs);
+
+    // Calls fn(id, Cs &...) for every matching entity
+    template <class F>
+    inline void each(F fn) const { _view.each(fn); }
+
+    // Only the ones that have changed, see View::eachChanged
+    template <class F>
+    inline void eachChanged(Archetype::Version since, F fn) const
+    {
+        _view.eachChanged(since, fn);
+    }
+
+    inline std::size_t size() const { return _view.size(); }
+    inline bool empty() const { return _view.empty(); }
+    inline const View<Cs...> &getView() const { return _view; }
+
+private:
+    View<Cs...> _view;
+    unsigned _types[COUNT];
+
+    Query() : _types{ TypeIds<Components::Component>::get<Cs>()... } {}
+
+    void match(Archetype *archetype) override
+    {
+        unsigned columns[COUNT];
+        for (std::size_t i = 0; i < COUNT; i++)
+        {
+            columns[i] = archetype->getColumn(_types[i]);
+            if (columns[i] == Archetype::NO_COLUMN) return;
+        }
+
+        _view.addMatch(archetype, columns);
+    }
+};
+
+#endif
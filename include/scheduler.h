@@ -0,0 +1,152 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __OGRE_SCHEDULER_H__
+#define __OGRE_SCHEDULER_H__
+
+#include "defines.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "entity.h"
+#include "jobsystem.h"
+#include "stringable.h"
+#include "typeids.h"
+
+#ifdef _DEBUG
+#   define _DEBUG_SCHEDULER
+#endif
+
+// A unit of per-frame game logic. Systems say up front which component
+// types they read and which they write, so the Scheduler knows which of them
+// can safely run at the same time
+class System : public Stringable
+{
+    friend class Scheduler;
+
+public:
+    virtual ~System() {}
+
+    virtual void update(float dt) = 0;
+
+    inline const std::string &getName() const { return _name; }
+    inline const std::vector<unsigned> &getReads() const { return _reads; }
+    inline const std::vector<unsigned> &getWrites() const { return _writes; }
+
+    // True if this and other can't run concurrently
+    bool conflictsWith(const System &other) const;
+
+    std::string toString() const override;
+
+protected:
+    System(const std::string &name) : _name(name) {}
+
+    // Call these from the subclass constructor
+    template <class T>
+    inline void reads() { _reads.push_back(getTypeId<T>()); }
+
+    template <class T>
+    inline void writes() { _writes.push_back(getTypeId<T>()); }
+
+private:
+    std::string _name;
+    std::vector<unsigned> _reads;
+    std::vector<unsigned> _writes;
+
+    template <class T>
+    static inline unsigned getTypeId()
+    {
+        static_assert(std::is_base_of<Components::Component, T>::value,
+                      "Systems can only declare access to types derived from class Components::Component");
+        return TypeIds<Components::Component>::get<T>();
+    }
+};
+
+// Runs every registered System once per frame as jobs on a JobSystem. Two
+// systems conflict if either writes a component type the other touches.
+// Conflicting systems run in the order they were added, anything else is
+// free to overlap. The calling thread works through systems too
+class Scheduler : public Stringable
+{
+public:
+    explicit Scheduler(JobSystem &jobs);
+
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    // Takes ownership
+    System *add(std::unique_ptr<System> system);
+
+    template <class S, class... Args>
+    S *add(Args&& ... args)
+    {
+        return static_cast<S *>(
+            add(std::unique_ptr<System>(new S(std::forward<Args>(args)...))));
+    }
+
+    void remove(System *system);
+
+    // Runs every system once and returns when they've all finished.
+    // Rethrows the first exception any of them threw
+    void update(float dt);
+
+    inline unsigned getThreadCount() const { return _jobs.getThreadCount(); }
+
+    // Human-readable dump of the dependency graph and of which thread ran
+    // each system when during the last update
+    std::string getSchedule() const;
+
+    std::string toString() const override;
+
+private:
+    struct Node
+    {
+        std::unique_ptr<System> system;
+        std::vector<unsigned> dependencies;
+        std::vector<unsigned> dependents;
+
+        // Last update, in microseconds from its start
+        unsigned thread;
+        std::int64_t start;
+        std::int64_t end;
+    };
+
+    JobSystem &_jobs;
+    std::vector<Node> _nodes;
+    bool _dirty;
+
+    // Per update, indexed like _nodes: dependencies yet to finish
+    std::unique_ptr<std::atomic<unsigned>[]> _pending;
+    JobCounter _counter;
+    float _dt;
+    std::mutex _errorMutex;
+    std::exception_ptr _error;
+    std::chrono::steady_clock::time_point _frameStart;
+
+    void buildGraph();
+    void submit(unsigned node);
+    void runNode(unsigned node);
+};
+
+#endif
@@ -0,0 +1,149 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_SIZECLASSPOOL_H__
+#define __OGRE_SIZECLASSPOOL_H__
+
+#include "defines.h"
+
+#include <cstddef>
+#include <new>
+
+#include "pool.h"
+
+// Opaque block of Size bytes, the element type of each size class
+template <std::size_t Size>
+struct alignas(alignof(std::max_align_t)) SizeClassBlock
+{
+    unsigned char bytes[Size];
+};
+
+// Allocator for objects whose size is only known at runtime, such as the
+// subclasses of a polymorphic base. Requests are rounded up to the nearest
+// power-of-two size class, each backed by its own GrowablePool starting at N
+// blocks. Anything larger than MAX_SIZE goes to the general heap.
+//
+// Like Pool, this isn't thread-safe
+template <unsigned N>
+class SizeClassPool
+{
+public:
+    static constexpr std::size_t MAX_SIZE = 512;
+
+    void *allocate(std::size_t size);
+    void release(void *p, std::size_t size) noexcept;
+
+private:
+    template <std::size_t Size>
+    using SizeClass = GrowablePool<SizeClassBlock<Size>, N>;
+
+    SizeClass<32> _class32;
+    SizeClass<64> _class64;
+    SizeClass<128> _class128;
+    SizeClass<256> _class256;
+    SizeClass<512> _class512;
+};
+
+// Base for polymorphic class hierarchies whose instances should come out of
+// a SizeClassPool, in the same vein as PoolableObject. Deleting through a
+// base pointer relies on the virtual destructor handing operator delete the
+// size of the most-derived type, so Base must have one
+template <class Base, unsigned N>
+class SizeClassPoolable
+{
+public:
+    static void *operator new(std::size_t sz)
+    {
+        void *p = getPool().allocate(sz);
+#ifdef _DEBUG_POOL
+        LOG_DEBUG << "allocated " << sz << " byte object derived from "
+                  << boost::core::demangle(typeid(Base).name())
+                  << " at " << p;
+#endif
+        return p;
+    }
+
+    static void operator delete(void *p, std::size_t sz)
+    {
+        if (p)
+        {
+#ifdef _DEBUG_POOL
+            LOG_DEBUG << "releasing " << sz << " byte object derived from "
+                      << boost::core::demangle(typeid(Base).name())
+                      << " at " << p;
+#endif
+            getPool().release(p, sz);
+        }
+#ifdef _DEBUG
+        else
+        {
+            LOG_WARNING << "deleting null object";
+        }
+#endif
+    }
+
+protected:
+    static SizeClassPool<N> &getPool()
+    {
+        static SizeClassPool<N> pool;
+        return pool;
+    }
+};
+
+template <unsigned N>
+void *SizeClassPool<N>::allocate(std::size_t size)
+{
+    if (size <= 32)  return _class32.allocate();
+    if (size <= 64)  return _class64.allocate();
+    if (size <= 128) return _class128.allocate();
+    if (size <= 256) return _class256.allocate();
+    if (size <= 512) return _class512.allocate();
+
+    return ::operator new(size);
+}
+
+template <unsigned N>
+void SizeClassPool<N>::release(void *p, std::size_t size) noexcept
+{
+    // Has to land in the same class allocate() picked for this size
+    if (size <= 32)
+    {
+        _class32.release(static_cast<SizeClassBlock<32> *>(p));
+    }
+    else if (size <= 64)
+    {
+        _class64.release(static_cast<SizeClassBlock<64> *>(p));
+    }
+    else if (size <= 128)
+    {
+        _class128.release(static_cast<SizeClassBlock<128> *>(p));
+    }
+    else if (size <= 256)
+    {
+        _class256.release(static_cast<SizeClassBlock<256> *>(p));
+    }
+    else if (size <= 512)
+    {
+        _class512.release(static_cast<SizeClassBlock<512> *>(p));
+    }
+    else
+    {
+        ::operator delete(p);
+    }
+}
+
+#endif
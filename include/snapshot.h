@@ -0,0 +1,276 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_SNAPSHOT_H__
+#define __OGRE_SNAPSHOT_H__
+
+#include "defines.h"
+
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "entity.h"
+#include "exceptions.h"
+#include "typeids.h"
+
+class Archetype;
+class EntityManager;
+class SnapshotReader;
+class SnapshotWriter;
+
+namespace Exceptions
+{
+    class BadSnapshot : public Exception
+    {
+    public:
+        BadSnapshot(const std::string &path, const std::string &reason) :
+            Exception(error(path, reason)) {}
+
+    private:
+        std::string error(const std::string &path, const std::string &reason)
+        {
+            std::ostringstream ss;
+            ss << "snapshot \"" << path << "\": " << reason;
+            return ss.str();
+        }
+    };
+}
+
+// Specialise this for every component type that should be saved in a
+// snapshot, then register the type with Snapshot::registerType. It needs:
+//
+//     // Bump whenever the saved layout changes
+//     static constexpr std::uint32_t VERSION = 1;
+//
+//     static void save(const C &component, SnapshotWriter &out);
+//
+//     // Builds the component for the given entity from what save() wrote,
+//     // without registering it with the EntityManager. The entity may
+//     // still have its old C while this runs, so anything it claims by
+//     // name should go through Component::makeUniqueName
+//     static C *load(Entity::ID parent, SnapshotReader &in);
+//
+// Components of types without one are left out of snapshots
+template <class C>
+struct SnapshotTraits;
+
+// Appends plain data to a snapshot being written
+class SnapshotWriter
+{
+public:
+    template <class T>
+    void write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Can only write trivially copyable types");
+        writeBytes(&value, sizeof(T));
+    }
+
+    void write(const std::string &value);
+
+    // IDs are written as they are and relocated when loaded, see
+    // SnapshotReader::readEntity
+    inline void writeEntity(Entity::ID id) { write(id.getValue()); }
+
+    void writeBytes(const void *data, std::size_t size);
+
+    inline std::size_t getSize() const { return _data.size(); }
+
+    // Writes everything so far out to a file. Goes by way of a temporary
+    // file, so a crash part way through leaves any existing file intact
+    void writeFile(const std::string &path) const;
+
+private:
+    friend class Snapshot;
+
+    std::vector<char> _data;
+
+    // Overwrites something written earlier, e.g. a size that wasn't known
+    // at the time
+    template <class T>
+    void writeAt(std::size_t offset, const T &value)
+    {
+        std::memcpy(_data.data() + offset, &value, sizeof(T));
+    }
+};
+
+// Reads plain data back out of a mapped snapshot. Running off the end of
+// the data throws Exceptions::BadSnapshot
+class SnapshotReader
+{
+public:
+    template <class T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Can only read trivially copyable types");
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    std::string readString();
+
+    // Maps an entity ID as it was when saved to the entity it was loaded
+    // as. IDs of entities that weren't in the snapshot come back null
+    Entity::ID readEntity();
+
+    inline std::size_t getOffset() const
+    {
+        return static_cast<std::size_t>(_pos - _begin);
+    }
+
+private:
+    friend class Snapshot;
+
+    const char *_begin;
+    const char *_pos;
+    const char *_end;
+    const std::string &_path;
+    const std::unordered_map<std::uint32_t, Entity::ID> *_relocations;
+
+    SnapshotReader(const char *data, std::size_t size,
+                   const std::string &path) :
+        _begin(data),
+        _pos(data),
+        _end(data + size),
+        _path(path),
+        _relocations(nullptr) {}
+
+    const char *take(std::size_t size);
+};
+
+// Binary snapshots of every entity in an EntityManager along with the
+// components that have SnapshotTraits, for loading levels without running
+// the code that built them.
+//
+// Files are laid out archetype by archetype: the saved entity IDs first,
+// then each component type's data as a block. Loading maps the file rather
+// than reading it, hands out all the new IDs at once, fills each archetype's
+// rows directly instead of moving entities from archetype to archetype, and
+// relocates saved IDs to new ones with a single lookup table. Files are in
+// the saving machine's byte order and only meant to be loaded by the same
+// build.
+//
+// A delta holds only the entities that changed since the last capture, see
+// EntityManager::setChangeTracking, plus the ones destroyed. Loaded on top
+// of the snapshot it follows, using the same relocation table, it replaces
+// each changed entity's components with the ones saved
+class Snapshot final
+{
+public:
+    static constexpr std::uint32_t VERSION = 2;
+
+    // Entity IDs as saved to the entities they were loaded as
+    typedef std::unordered_map<std::uint32_t, Entity::ID> Relocations;
+
+    // Header of a snapshot file. Deltas carry the chain of the snapshot
+    // they follow and count up from 1
+    struct Info
+    {
+        bool isDelta;
+        std::uint64_t chain;
+        std::uint32_t sequence;
+    };
+
+    Snapshot() = delete;
+
+    template <class C>
+    static void registerType();
+
+    // Serialises every entity in the manager. Only call this when no
+    // systems are running
+    static SnapshotWriter capture(EntityManager &manager,
+                                  std::uint64_t chain = 0);
+
+    // As above, but only what's changed since the last call, and the
+    // sequence number to go with it. Takes the manager's changes
+    static SnapshotWriter captureChanges(EntityManager &manager,
+                                         std::uint64_t chain,
+                                         std::uint32_t sequence);
+
+    // capture() straight to a file
+    static void save(EntityManager &manager, const std::string &path);
+
+    // Reads the header of a snapshot or delta
+    static Info inspect(const std::string &path);
+
+    // Creates an entity for every new one in the file, on top of whatever
+    // the manager already has. Entities the relocation table already knows
+    // about have their components replaced instead. One EntitiesCreated is
+    // raised for the new ones, and no component creation events. Returns
+    // every entity loaded, in file order. If anything fails to load, the
+    // manager and relocation table are left as they were
+    static std::vector<Entity::ID> load(EntityManager &manager,
+                                        const std::string &path,
+                                        Relocations &relocations,
+                                        const std::string &debugName = "");
+
+    // For a lone snapshot, with no deltas to follow it
+    static std::vector<Entity::ID> load(EntityManager &manager,
+                                        const std::string &path,
+                                        const std::string &debugName = "");
+
+private:
+    typedef void (*SaveFn)(const Components::Component &, SnapshotWriter &);
+    typedef Components::Component *(*LoadFn)(Entity::ID, SnapshotReader &);
+
+    struct TypeInfo
+    {
+        std::uint32_t version;
+        SaveFn save;
+        LoadFn load;
+    };
+
+    // Rows to save, a run of them per archetype
+    struct Selection
+    {
+        Archetype *archetype;
+        std::vector<unsigned> rows;
+    };
+
+    // Indexed by component type ID, null save for unregistered types
+    static std::vector<TypeInfo> &getTypes();
+    static void addType(unsigned type, const TypeInfo &info);
+
+    static SnapshotWriter write(EntityManager &manager, const Info &info,
+                                const std::vector<Selection> &selections,
+                                const std::vector<Entity::ID> &destroyed);
+    static Info readHeader(SnapshotReader &in, const std::string &path);
+};
+
+template <class C>
+void Snapshot::registerType()
+{
+    static_assert(std::is_base_of<Components::Component, C>::value,
+                  "Can only register types derived from class Components::Component");
+
+    TypeInfo info;
+    info.version = SnapshotTraits<C>::VERSION;
+    info.save = [](const Components::Component &component, SnapshotWriter &out)
+        { SnapshotTraits<C>::save(static_cast<const C &>(component), out); };
+    info.load = [](Entity::ID parent, SnapshotReader &in)
+        -> Components::Component * { return SnapshotTraits<C>::load(parent, in); };
+    addType(TypeIds<Components::Component>::get<C>(), info);
+}
+
+#endif
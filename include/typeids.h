@@ -0,0 +1,78 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __OGRE_TYPEIDS_H__
+#define __OGRE_TYPEIDS_H__
+
+#include "defines.h"
+
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+
+namespace detail
+{
+    // Registry behind TypeIds, keyed on type names rather than type_info
+    // addresses so every module in the process agrees on the numbering
+    unsigned getTypeId(const std::type_info &family, const std::type_info &type);
+    unsigned getTypeIdCount(const std::type_info &family);
+    std::string getTypeIdName(const std::type_info &family, unsigned id);
+}
+
+// Dense, process-wide integer IDs for the types in a family, e.g. every
+// component type or every event type. IDs count up from 0 in the order types
+// are first seen, so they can index flat arrays.
+//
+// The first lookup of each type in each module takes a lock, after that the
+// ID is cached in a function-local static
+template <class Family>
+class TypeIds
+{
+private:
+    TypeIds() {}
+
+public:
+    template <class T>
+    static inline unsigned get()
+    {
+        static_assert(std::is_base_of<Family, T>::value,
+                      "type isn't a member of this family");
+
+        static const unsigned id = detail::getTypeId(typeid(Family), typeid(T));
+        return id;
+    }
+
+    // For when the type is only known at runtime, e.g. typeid(*ptr). Always
+    // takes the lock, so keep it off hot paths
+    static inline unsigned get(const std::type_info &type)
+    {
+        return detail::getTypeId(typeid(Family), type);
+    }
+
+    // Number of IDs handed out so far
+    static inline unsigned getCount()
+    {
+        return detail::getTypeIdCount(typeid(Family));
+    }
+
+    // Demangled name of the type with the given ID
+    static inline std::string getName(unsigned id)
+    {
+        return detail::getTypeIdName(typeid(Family), id);
+    }
+};
+
+#endif
@@ -0,0 +1,171 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __OGRE_VIEW_H__
+#define __OGRE_VIEW_H__
+
+#include "defines.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "archetype.h"
+
+// Every entity that has all of the components Cs..., as of when the view was
+// made. Holds the matching archetypes rather than the entities, so it stays
+// valid as entities come and go within them, but adding or removing
+// components while iterating isn't allowed. See EntityManager::view
+template <class... Cs>
+class View
+{
+    friend class EntityManager;
+
+    template <class...>
+    friend class Query;
+
+public:
+    static constexpr std::size_t COUNT = sizeof...(Cs);
+
+    static_assert(COUNT > 0, "View needs at least one component type");
+
+    // Calls fn(id, Cs &...) for every matching entity
+    template <class F>
+    void each(F fn) const
+    {
+        for (auto &match : _matches)
+        {
+            eachIn(match.archetype, match.columns, fn);
+        }
+    }
+
+    // Calls fn(id, Cs &...) for every matching entity where at least one of
+    // Cs... has changed at or after the given version, see
+    // EntityManager::getVersion
+    template <class F>
+    void eachChanged(Archetype::Version since, F fn) const
+    {
+        for (auto &match : _matches)
+        {
+            eachChangedIn(match.archetype, match.columns, since, fn);
+        }
+    }
+
+    std::size_t size() const
+    {
+        std::size_t total = 0;
+        for (auto &match : _matches)
+        {
+            total += match.archetype->getSize();
+        }
+        return total;
+    }
+
+    inline bool empty() const { return size() == 0; }
+
+private:
+    struct Match
+    {
+        Archetype *archetype;
+        unsigned columns[COUNT];
+    };
+
+    std::vector<Match> _matches;
+
+    View() {}
+
+    inline void addMatch(Archetype *archetype, const unsigned (&columns)[COUNT])
+    {
+        Match match;
+        match.archetype = archetype;
+        std::copy(std::begin(columns), std::end(columns), match.columns);
+        _matches.push_back(match);
+    }
+
+    template <class F>
+    static inline void eachIn(Archetype *archetype,
+                              const unsigned (&columns)[COUNT], F &fn)
+    {
+        eachIn(archetype, columns, fn, std::index_sequence_for<Cs...>());
+    }
+
+    template <class F, std::size_t... I>
+    static void eachIn(Archetype *archetype, const unsigned (&columns)[COUNT],
+                       F &fn, std::index_sequence<I...>)
+    {
+        // Components are stored under their exact type, so no dynamic_cast
+        for (unsigned chunk = 0; chunk < archetype->getChunkCount(); chunk++)
+        {
+            auto count = archetype->getChunkSize(chunk);
+            auto entities = archetype->getEntities(chunk);
+            Components::Component **data[COUNT] =
+                { archetype->getColumnData(chunk, columns[I])... };
+            for (unsigned row = 0; row < count; row++)
+            {
+                fn(entities[row], *static_cast<Cs *>(data[I][row])...);
+            }
+        }
+    }
+
+    template <class F>
+    static inline void eachChangedIn(Archetype *archetype,
+                                     const unsigned (&columns)[COUNT],
+                                     Archetype::Version since, F &fn)
+    {
+        eachChangedIn(archetype, columns, since, fn,
+                      std::index_sequence_for<Cs...>());
+    }
+
+    template <class F, std::size_t... I>
+    static void eachChangedIn(Archetype *archetype,
+                              const unsigned (&columns)[COUNT],
+                              Archetype::Version since, F &fn,
+                              std::index_sequence<I...>)
+    {
+        for (unsigned chunk = 0; chunk < archetype->getChunkCount(); chunk++)
+        {
+            bool changed = false;
+            for (auto column : columns)
+            {
+                changed |= archetype->getChunkVersion(chunk, column) >= since;
+            }
+            if (!changed) continue;
+
+            auto count = archetype->getChunkSize(chunk);
+            auto entities = archetype->getEntities(chunk);
+            Components::Component **data[COUNT] =
+                { archetype->getColumnData(chunk, columns[I])... };
+            const Archetype::Version *versions[COUNT] =
+                { archetype->getVersionData(chunk, columns[I])... };
+            for (unsigned row = 0; row < count; row++)
+            {
+                changed = false;
+                for (auto column : versions)
+                {
+                    changed |= column[row] >= since;
+                }
+                if (changed)
+                {
+                    fn(entities[row], *static_cast<Cs *>(data[I][row])...);
+                }
+            }
+        }
+    }
+};
+
+#endif
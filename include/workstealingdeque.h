@@ -0,0 +1,171 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __OGRE_WORKSTEALINGDEQUE_H__
+#define __OGRE_WORKSTEALINGDEQUE_H__
+
+#include "defines.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "poolmemory.h"
+
+// Chase-Lev work-stealing deque of pointers, after Le et al., "Correct and
+// Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+//
+// Only the owning thread may push() and pop(), which work on the bottom end.
+// Any thread may steal() from the top. Empty pops and steals, and steals
+// that lose a race, return null. The ring grows as needed; outgrown rings are
+// kept until the deque dies since a thief may still be reading one
+template <class T>
+class WorkStealingDeque
+{
+public:
+    explicit WorkStealingDeque(std::int64_t capacity = 256) :
+        _top(0),
+        _bottom(0)
+    {
+        // Capacity must be a power of two
+        std::int64_t size = 1;
+        while (size < capacity) size <<= 1;
+
+        _rings.emplace_back(new Ring(size));
+        _ring.store(_rings.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    void push(T *item)
+    {
+        auto b = _bottom.load(std::memory_order_relaxed);
+        auto t = _top.load(std::memory_order_acquire);
+        auto ring = _ring.load(std::memory_order_relaxed);
+
+        if (b - t > ring->capacity - 1)
+        {
+            ring = grow(ring, t, b);
+        }
+
+        // A release store rather than the paper's release fence, which says
+        // the same thing but is easier on ThreadSanitizer
+        ring->put(b, item);
+        _bottom.store(b + 1, std::memory_order_release);
+    }
+
+    T *pop()
+    {
+        auto b = _bottom.load(std::memory_order_relaxed) - 1;
+        auto ring = _ring.load(std::memory_order_relaxed);
+        _bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = _top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            // Empty
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T *item = ring->get(b);
+        if (t == b)
+        {
+            // Last item, so race any thieves for it
+            if (!_top.compare_exchange_strong(t, t + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed))
+            {
+                item = nullptr;
+            }
+            _bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    T *steal()
+    {
+        auto t = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto b = _bottom.load(std::memory_order_acquire);
+
+        if (t >= b) return nullptr;
+
+        auto ring = _ring.load(std::memory_order_acquire);
+        T *item = ring->get(t);
+        if (!_top.compare_exchange_strong(t, t + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // Only a hint unless called by the owner
+    inline bool empty() const
+    {
+        return _bottom.load(std::memory_order_relaxed) <=
+               _top.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Ring
+    {
+        std::int64_t capacity;
+        std::unique_ptr<std::atomic<T *>[]> items;
+
+        Ring(std::int64_t capacity) :
+            capacity(capacity),
+            items(new std::atomic<T *>[capacity]) {}
+
+        inline T *get(std::int64_t i) const
+        {
+            return items[i & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        inline void put(std::int64_t i, T *item)
+        {
+            items[i & (capacity - 1)].store(item, std::memory_order_relaxed);
+        }
+    };
+
+    // Owner and thieves both hammer on top, only the owner touches bottom
+    alignas(CACHE_LINE_SIZE) std::atomic<std::int64_t> _top;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::int64_t> _bottom;
+    std::atomic<Ring *> _ring;
+
+    // Owner only
+    std::vector<std::unique_ptr<Ring>> _rings;
+
+    Ring *grow(Ring *ring, std::int64_t top, std::int64_t bottom)
+    {
+        auto bigger = new Ring(ring->capacity * 2);
+        for (auto i = top; i < bottom; i++)
+        {
+            bigger->put(i, ring->get(i));
+        }
+
+        _rings.emplace_back(bigger);
+        _ring.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+};
+
+#endif
@@ -0,0 +1,184 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archetype.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "pool.h"
+
+namespace
+{
+    struct alignas(CACHE_LINE_SIZE) ChunkBlock
+    {
+        unsigned char bytes[Archetype::CHUNK_SIZE];
+    };
+
+    // All archetypes share one pool of chunks
+    GrowablePool<ChunkBlock, 16> &getChunkPool()
+    {
+        static GrowablePool<ChunkBlock, 16> pool;
+        return pool;
+    }
+}
+
+Archetype::Archetype(const Signature &signature) :
+    _signature(signature),
+    _size(0),
+    _chunkCapacity(0),
+    _columnsOffset(0),
+    _versionsOffset(0),
+    _reservedChunks(0)
+{
+    assert(std::is_sorted(_signature.begin(), _signature.end()));
+
+    // One ID plus one pointer and one version per column for every row,
+    // leaving enough slack to pad the ID array out so the pointer columns
+    // are aligned. The versions follow the pointers, which keeps them
+    // aligned too
+    const auto pointerAlign = alignof(Components::Component *);
+    auto rowSize = sizeof(ID) +
+                   _signature.size() * (sizeof(Components::Component *) +
+                                        sizeof(Version));
+    _chunkCapacity = static_cast<unsigned>((CHUNK_SIZE - pointerAlign) / rowSize);
+    assert(_chunkCapacity > 0);
+
+    _columnsOffset = (_chunkCapacity * sizeof(ID) + pointerAlign - 1) /
+                     pointerAlign * pointerAlign;
+    _versionsOffset = _columnsOffset +
+        _signature.size() * _chunkCapacity * sizeof(Components::Component *);
+
+    if (!_signature.empty())
+    {
+        _columns.assign(_signature.back() + 1, NO_COLUMN);
+        for (unsigned column = 0; column < _signature.size(); column++)
+        {
+            _columns[_signature[column]] = column;
+        }
+    }
+}
+
+Archetype::~Archetype()
+{
+    auto &pool = getChunkPool();
+    for (auto chunk : _chunks)
+    {
+        pool.release(reinterpret_cast<ChunkBlock *>(chunk));
+    }
+}
+
+unsigned Archetype::addRow(ID id, Version version)
+{
+    auto row = static_cast<unsigned>(_size);
+    if (row == _chunks.size() * _chunkCapacity) addChunk();
+    _size++;
+
+    getEntity(row) = id;
+    for (unsigned column = 0; column < _signature.size(); column++)
+    {
+        getComponent(row, column) = nullptr;
+        setVersion(row, column, version);
+    }
+
+    return row;
+}
+
+void Archetype::reserve(std::size_t rows)
+{
+    while (_chunks.size() * _chunkCapacity < rows)
+    {
+        addChunk();
+    }
+    _reservedChunks = std::max(_reservedChunks, _chunks.size());
+}
+
+bool Archetype::removeRow(unsigned row, ID &moved)
+{
+    assert(row < _size);
+
+    auto last = static_cast<unsigned>(_size - 1);
+    bool didMove = false;
+    if (row != last)
+    {
+        moved = getEntity(row) = getEntity(last);
+        for (unsigned column = 0; column < _signature.size(); column++)
+        {
+            getComponent(row, column) = getComponent(last, column);
+            setVersion(row, column, getVersion(last, column));
+        }
+        didMove = true;
+    }
+    _size--;
+
+    // Hand back trailing empty chunks beyond the spare and anything
+    // reserved
+    auto keep = std::max<std::size_t>(getChunkCount() + 1, _reservedChunks);
+    while (_chunks.size() > keep)
+    {
+        releaseChunk();
+    }
+
+    return didMove;
+}
+
+void Archetype::shrink()
+{
+    while (_chunks.size() > getChunkCount())
+    {
+        releaseChunk();
+    }
+    _reservedChunks = 0;
+}
+
+void Archetype::setAddEdge(TypeId type, Archetype *to)
+{
+    if (type >= _addEdges.size()) _addEdges.resize(type + 1, nullptr);
+    _addEdges[type] = to;
+}
+
+void Archetype::setRemoveEdge(TypeId type, Archetype *to)
+{
+    if (type >= _removeEdges.size()) _removeEdges.resize(type + 1, nullptr);
+    _removeEdges[type] = to;
+}
+
+void Archetype::addChunk()
+{
+    _chunks.push_back(getChunkPool().allocate()->bytes);
+    _chunkVersions.resize(_chunks.size() * _signature.size(), 0);
+}
+
+void Archetype::releaseChunk()
+{
+    getChunkPool().release(reinterpret_cast<ChunkBlock *>(_chunks.back()));
+    _chunks.pop_back();
+    _chunkVersions.resize(_chunks.size() * _signature.size());
+}
+
+std::string Archetype::toString() const
+{
+    std::ostringstream ss;
+    ss << "Archetype[components = {";
+    for (auto i = _signature.begin(); i != _signature.end(); i++)
+    {
+        if (i != _signature.begin()) ss << ", ";
+        ss << TypeIds<Components::Component>::getName(*i);
+    }
+    ss << "}, size = " << _size << ", chunks = " << _chunks.size() << "]";
+    return ss.str();
+}
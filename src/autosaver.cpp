@@ -0,0 +1,203 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "autosaver.h"
+
+#include <boost/filesystem.hpp>
+#include <chrono>
+#include <sstream>
+
+#include "entitymanager.h"
+#include "logger.h"
+
+Autosaver::Autosaver(EntityManager &manager, const std::string &path,
+                     unsigned fullEvery) :
+    _manager(manager),
+    _path(path),
+    _fullEvery(std::max(1u, fullEvery)),
+    _chain(0),
+    _sequence(0),
+    _brokenChain(0),
+    _writing(false),
+    _stopping(false)
+{
+    auto directory = boost::filesystem::path(path).parent_path();
+    if (!directory.empty()) boost::filesystem::create_directories(directory);
+
+    _thread = boost::thread(&Autosaver::writerLoop, this);
+}
+
+Autosaver::~Autosaver()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    _thread.join();
+
+    _manager.setChangeTracking(false);
+}
+
+void Autosaver::save()
+{
+    std::uint64_t chain;
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        if (_queue.size() >= MAX_QUEUED)
+        {
+            LOG_WARNING << "autosaves are falling behind, dropping "
+                        << _queue.size() << " queued saves";
+            _queue.clear();
+            _chain = 0;
+        }
+        if (_sequence + 1 >= _fullEvery) _chain = 0;
+        chain = _chain;
+    }
+
+    Write write;
+    if (!chain)
+    {
+        // Changes are counted from this snapshot on. The chain only has to
+        // tell this snapshot's deltas apart from any older ones on disk
+        _manager.setChangeTracking(true);
+        chain = static_cast<std::uint64_t>(
+            std::chrono::system_clock::now().time_since_epoch().count()) | 1;
+        _sequence = 0;
+
+        write.path = _path;
+        write.data = Snapshot::capture(_manager, chain);
+        write.isDelta = false;
+    }
+    else
+    {
+        _sequence++;
+
+        std::ostringstream ss;
+        ss << _path << "." << _sequence;
+        write.path = ss.str();
+        write.data = Snapshot::captureChanges(_manager, chain, _sequence);
+        write.isDelta = true;
+    }
+    write.chain = chain;
+
+    LOG_INFO << "autosaving " << write.data.getSize() << " bytes to \""
+             << write.path << "\"";
+
+    {
+        boost::lock_guard<boost::mutex> lock(_mutex);
+        if (!write.isDelta) _chain = chain;
+        _queue.push_back(std::move(write));
+    }
+    _wake.notify_one();
+}
+
+void Autosaver::flush()
+{
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    while (!_queue.empty() || _writing)
+    {
+        _idle.wait(lock);
+    }
+}
+
+Snapshot::Relocations Autosaver::load(EntityManager &manager,
+                                      const std::string &path)
+{
+    auto base = Snapshot::inspect(path);
+    if (base.isDelta)
+    {
+        throw Exceptions::BadSnapshot(path, "not a full snapshot");
+    }
+
+    Snapshot::Relocations relocations;
+    Snapshot::load(manager, path, relocations);
+
+    for (std::uint32_t sequence = 1; ; sequence++)
+    {
+        std::ostringstream ss;
+        ss << path << "." << sequence;
+        auto deltaPath = ss.str();
+        if (!boost::filesystem::exists(deltaPath)) break;
+
+        auto info = Snapshot::inspect(deltaPath);
+        if (!info.isDelta || info.chain != base.chain ||
+            info.sequence != sequence)
+        {
+            break;
+        }
+        Snapshot::load(manager, deltaPath, relocations);
+    }
+
+    return relocations;
+}
+
+std::string Autosaver::toString() const
+{
+    std::ostringstream ss;
+    ss << "Autosaver[path = \"" << _path << "\", fullEvery = " << _fullEvery
+       << ", sequence = " << _sequence << "]";
+    return ss.str();
+}
+
+void Autosaver::writerLoop()
+{
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    for (;;)
+    {
+        while (_queue.empty() && !_stopping)
+        {
+            _wake.wait(lock);
+        }
+        if (_queue.empty()) break;
+
+        auto write = std::move(_queue.front());
+        _queue.pop_front();
+        if (write.isDelta && write.chain == _brokenChain)
+        {
+            LOG_WARNING << "skipping autosave to \"" << write.path
+                        << "\", an earlier one failed";
+            if (_queue.empty()) _idle.notify_all();
+            continue;
+        }
+        _writing = true;
+
+        lock.unlock();
+        bool failed = false;
+        try
+        {
+            write.data.writeFile(write.path);
+        }
+        catch (const Exceptions::Exception &e)
+        {
+            LOG_ERROR << "autosave failed: " << e.what();
+            failed = true;
+        }
+        lock.lock();
+
+        // The changes that went into it are gone, so start over with a
+        // full snapshot
+        if (failed)
+        {
+            _brokenChain = write.chain;
+            if (_chain == write.chain) _chain = 0;
+        }
+
+        _writing = false;
+        if (_queue.empty()) _idle.notify_all();
+    }
+}
@@ -0,0 +1,38 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "commandbuffer.h"
+
+#include "entitymanager.h"
+
+Entity::ID CommandBuffer::createEntity(const std::string &debugName)
+{
+    Command command;
+    command.op = Op::CreateEntity;
+    command.id = _manager.reserveEntity();
+    command.debugName = debugName;
+    _commands.push_back(std::move(command));
+
+    return _commands.back().id;
+}
+
+void CommandBuffer::destroyEntity(ID id)
+{
+    Command command;
+    command.op = Op::DestroyEntity;
+    command.id = id;
+    _commands.push_back(std::move(command));
+}
@@ -4,8 +4,7 @@
 
 namespace Components {
 
-Camera *Camera::create(const Entity::UUID &parent,
-                       const std::string &debugName)
+Camera *Camera::create(Entity::ID parent, DebugName debugName)
 {
     auto ptr = new Camera(parent, debugName);
     Events::Dispatcher::raise<Events::ComponentCreated>(ptr);
@@ -13,15 +12,14 @@ Camera *Camera::create(const Entity::UUID &parent,
     return ptr;
 }
 
-Camera::Camera(const Entity::UUID &parent,
-               const std::string &debugName) :
-    Component(parent, debugName),
+Camera::Camera(Entity::ID parent, DebugName debugName) :
+    Specific(parent, debugName),
     ogreSceneNode(nullptr),
     ogreCamera(nullptr)
 {
     auto sceneMgr = getGame()->getOgreSceneMgr();
     
-    ogreCamera = sceneMgr->createCamera("MainCamera");
+    ogreCamera = sceneMgr->createCamera(makeUniqueName("Camera"));
     ogreCamera->setNearClipDistance(5);
     ogreSceneNode = sceneMgr->getRootSceneNode()->createChildSceneNode();
     ogreSceneNode->attachObject(ogreCamera);
@@ -29,6 +27,15 @@ Camera::Camera(const Entity::UUID &parent,
     ogreSceneNode->lookAt(Ogre::Vector3(0, 0, -300), Ogre::SceneNode::TS_WORLD);
 }
 
+Camera::~Camera()
+{
+    auto sceneMgr = getGame()->getOgreSceneMgr();
+
+    // Destroying the node detaches the camera from it first
+    if (ogreSceneNode) sceneMgr->destroySceneNode(ogreSceneNode);
+    if (ogreCamera) sceneMgr->destroyCamera(ogreCamera);
+}
+
 std::string Camera::toString() const
 {
     std::ostringstream ss;
@@ -36,4 +43,41 @@ std::string Camera::toString() const
     return ss.str();
 }
 
-} // namespace Components
\ No newline at end of file
+} // namespace Components
+
+void SnapshotTraits<Components::Camera>::save(const Components::Camera &camera,
+                                              SnapshotWriter &out)
+{
+    auto &position = camera.ogreSceneNode->getPosition();
+    out.write(position.x);
+    out.write(position.y);
+    out.write(position.z);
+
+    auto &orientation = camera.ogreSceneNode->getOrientation();
+    out.write(orientation.w);
+    out.write(orientation.x);
+    out.write(orientation.y);
+    out.write(orientation.z);
+}
+
+Components::Camera *SnapshotTraits<Components::Camera>::load(Entity::ID parent,
+                                                             SnapshotReader &in)
+{
+    auto camera = new Components::Camera(
+        parent, Components::Camera::getTypeDebugName());
+
+    Ogre::Vector3 position;
+    position.x = in.read<Ogre::Real>();
+    position.y = in.read<Ogre::Real>();
+    position.z = in.read<Ogre::Real>();
+    camera->ogreSceneNode->setPosition(position);
+
+    Ogre::Quaternion orientation;
+    orientation.w = in.read<Ogre::Real>();
+    orientation.x = in.read<Ogre::Real>();
+    orientation.y = in.read<Ogre::Real>();
+    orientation.z = in.read<Ogre::Real>();
+    camera->ogreSceneNode->setOrientation(orientation);
+
+    return camera;
+}
\ No newline at end of file
@@ -4,8 +4,7 @@
 
 namespace Components {
 
-Light *Light::create(const Entity::UUID &parent,
-                     const std::string &debugName)
+Light *Light::create(Entity::ID parent, DebugName debugName)
 {
     auto ptr = new Light(parent, debugName);
     Events::Dispatcher::raise<Events::ComponentCreated>(ptr);
@@ -13,20 +12,28 @@ Light *Light::create(const Entity::UUID &parent,
     return ptr;
 }
 
-Light::Light(const Entity::UUID &parent,
-             const std::string &debugName) :
-    Component(parent, debugName),
+Light::Light(Entity::ID parent, DebugName debugName) :
+    Specific(parent, debugName),
     ogreSceneNode(nullptr),
     ogreLight(nullptr)
 {
     auto sceneMgr = getGame()->getOgreSceneMgr();
     
-    ogreLight = sceneMgr->createLight("MainLight");
+    ogreLight = sceneMgr->createLight(makeUniqueName("Light"));
     ogreSceneNode = sceneMgr->getRootSceneNode()->createChildSceneNode();
     ogreSceneNode->attachObject(ogreLight);
     ogreSceneNode->setPosition(20, 80, 50);
 }
 
+Light::~Light()
+{
+    auto sceneMgr = getGame()->getOgreSceneMgr();
+
+    // Destroying the node detaches the light from it first
+    if (ogreSceneNode) sceneMgr->destroySceneNode(ogreSceneNode);
+    if (ogreLight) sceneMgr->destroyLight(ogreLight);
+}
+
 std::string Light::toString() const
 {
     std::ostringstream ss;
@@ -34,4 +41,28 @@ std::string Light::toString() const
     return ss.str();
 }
 
-} // namespace Components
\ No newline at end of file
+} // namespace Components
+
+void SnapshotTraits<Components::Light>::save(const Components::Light &light,
+                                             SnapshotWriter &out)
+{
+    auto &position = light.ogreSceneNode->getPosition();
+    out.write(position.x);
+    out.write(position.y);
+    out.write(position.z);
+}
+
+Components::Light *SnapshotTraits<Components::Light>::load(Entity::ID parent,
+                                                           SnapshotReader &in)
+{
+    auto light = new Components::Light(
+        parent, Components::Light::getTypeDebugName());
+
+    Ogre::Vector3 position;
+    position.x = in.read<Ogre::Real>();
+    position.y = in.read<Ogre::Real>();
+    position.z = in.read<Ogre::Real>();
+    light->ogreSceneNode->setPosition(position);
+
+    return light;
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "debugname.h"
+
+#include <cassert>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    // Constructed on first use, since names may be interned during static
+    // initialisation. Strings live in a deque so references handed out by
+    // getDebugName stay valid as the table grows
+    struct Registry
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::uint32_t> ids;
+        std::deque<std::string> names;
+
+        Registry()
+        {
+            ids.emplace(std::string(), 0);
+            names.emplace_back();
+        }
+    };
+
+    Registry &getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+}
+
+std::uint32_t detail::internDebugName(const std::string &name)
+{
+    if (name.empty()) return 0;
+
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto result = registry.ids.emplace(
+        name, static_cast<std::uint32_t>(registry.names.size()));
+    if (result.second)
+    {
+        registry.names.push_back(name);
+    }
+    return result.first->second;
+}
+
+const std::string &detail::getDebugName(std::uint32_t id)
+{
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    assert(id < registry.names.size());
+    return registry.names[id];
+}
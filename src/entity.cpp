@@ -17,41 +17,45 @@
 
 #include "entity.h"
 
+#include <atomic>
 #include <sstream>
 
 #include "entitymanager.h"
 #include "events.h"
-#include "game.h"
 #include "logger.h"
 
-Entity::UUID Entity::create(const std::string &debugName)
+Entity::ID Entity::create(const std::string &debugName)
 {
-    return getGame()->getEntityMgr()->createEntity(debugName);
+    return EntityManager::getCurrent()->createEntity(debugName);
 }
 
 Entity::Entity(const std::string &debugName)
 {
-    _uuid = create(debugName);
+    _id = create(debugName);
 }
 
 const std::string &Entity::getDebugName() const
 {
-    return getGame()->getEntityMgr()->getDebugName(_uuid);
+    return EntityManager::getCurrent()->getDebugName(_id);
+}
+
+const uuid::uuid &Entity::getUUID() const
+{
+    return EntityManager::getCurrent()->getUUID(_id);
 }
 
 std::string Entity::toString() const
 {
     std::ostringstream ss;
-    ss << "Entity[uuid = " << _uuid
+    ss << "Entity[id = " << _id
        << ", debugName = \"" << getDebugName() << "\"]";
     return ss.str();
 }
 
-Components::Component::Component(const Entity::UUID &parentUUID,
-                                 const std::string &debugName) :
-    _parentUUID(parentUUID)
+Components::Component::Component(Entity::ID parent, DebugName debugName) :
+    _parent(parent),
+    _debugName(debugName)
 {
-    setDebugName(Entity(parentUUID).getDebugName() + debugName);
 }
 
 Components::Component::~Component()
@@ -61,6 +65,25 @@ Components::Component::~Component()
 #endif
 }
 
+std::string Components::Component::getDebugName() const
+{
+#ifdef _DEBUG_NAMES
+    // The parent may already be gone, e.g. while it's being torn down
+    auto entityMgr = EntityManager::getCurrent();
+    if (!entityMgr || !entityMgr->isAlive(_parent)) return _debugName.str();
+
+    return entityMgr->getDebugName(_parent) + _debugName.str();
+#else
+    return std::string();
+#endif
+}
+
+std::string Components::Component::makeUniqueName(const std::string &prefix)
+{
+    static std::atomic<std::uint64_t> next(0);
+    return prefix + "#" + std::to_string(next.fetch_add(1, std::memory_order_relaxed));
+}
+
 std::string Components::Component::toString() const
 {
     std::ostringstream ss;
@@ -17,74 +17,312 @@
 
 #include "entitymanager.h"
 #include <algorithm>
+#include <atomic>
 
-EntityManager::EntityManager()
+namespace
 {
+    std::atomic<unsigned> _nextId(0);
+
+    EntityManager *_current = nullptr;
+
+    // This thread's command buffers, indexed by EntityManager ID
+    thread_local std::vector<CommandBuffer *> _threadCommandBuffers;
+}
+
+EntityManager::EntityManager() :
+    _entityCount(0),
+    _nextIndex(0),
+    _trackChanges(false),
+    _version(1),
+    _id(_nextId++)
+{
+    // Every entity starts out in the archetype with no components
+    _emptyArchetype = getArchetype(Archetype::Signature());
+
     //Events::Dispatcher::subscribe<Events::EntityCreated>(*this);
     Events::Dispatcher::subscribe<Events::ComponentCreated>(*this);
 }
 
 EntityManager::~EntityManager()
 {
-    // TODO: update this as necessary for additional cleanup procedures
+    Events::Dispatcher::unsubscribe(*this);
+
+    // Whatever's left is torn down one component type at a time
+    std::size_t componentCount = 0;
+    for (auto &pair : _archetypes)
+    {
+        auto archetype = pair.second.get();
+        auto size = static_cast<unsigned>(archetype->getSize());
+        for (unsigned column = 0; column < archetype->getSignature().size(); column++)
+        {
+            for (unsigned row = 0; row < size; row++)
+            {
+                delete archetype->getComponent(row, column);
+            }
+            componentCount += size;
+        }
+    }
 
-    //for (auto &pair : _map)
-    //{
-    //}
+    LOG_INFO << "destroyed " << _entityCount << " entities and "
+             << componentCount << " components still alive at shutdown";
 
-    Events::Dispatcher::unsubscribe(*this);
-    _map.clear();
+    _records.clear();
+    _archetypes.clear();
+
+    if (_current == this) _current = nullptr;
 }
 
-Entity::UUID EntityManager::createEntity(const std::string &debugName)
+EntityManager *EntityManager::getCurrent()
 {
-    auto uuid = uuid::generate();
+    return _current;
+}
 
-    if (_map.count(uuid))
+void EntityManager::setCurrent(EntityManager *manager)
+{
+    _current = manager;
+}
+
+Entity::ID EntityManager::createEntity(const std::string &debugName)
+{
+    auto id = reserveEntity();
+    insertEntity(id, debugName);
+
+    Events::Dispatcher::raise<Events::EntityCreated>(id);
+
+#ifdef _DEBUG_ENTITIES
+    LOG_DEBUG << "created entity " << Entity(id).toString();
+#endif
+
+    return id;
+}
+
+void EntityManager::destroyEntity(ID id)
+{
+    auto record = findRecord(id);
+    if (!record)
     {
-        throw Exceptions::EntityExists(uuid);
+        throw Exceptions::NoSuchEntity(id);
     }
-    if (_debugNameMap.count(uuid))
+
+    auto archetype = record->archetype;
+    for (unsigned column = 0; column < archetype->getSignature().size(); column++)
     {
-        LOG_WARNING << "entity with UUID " << uuid << " already exists in "
-                    << "_debugNameMap, but not in _map";
+        delete archetype->getComponent(record->row, column);
     }
+    eraseEntity(*record);
 
-    _map[uuid] = ComponentMap();
-    _debugNameMap[uuid] = debugName;
+    Events::Dispatcher::raise<Events::EntityDestroyed>(id);
+}
 
-    Events::Dispatcher::raise<Events::EntityCreated>(uuid);
+std::vector<Entity::ID> EntityManager::createEntities(
+    std::size_t count, const std::string &debugName)
+{
+    auto ids = reserveEntities(count);
+
+    _records.reserve(_nextIndex);
+#ifdef _DEBUG_NAMES
+    _debugNames.reserve(_nextIndex);
+#endif
+    _emptyArchetype->reserve(_emptyArchetype->getSize() + count);
+
+    // Intern the name once for the whole batch
+    DebugName name(debugName);
+    for (auto id : ids)
+    {
+        insertEntity(id, name);
+    }
 
 #ifdef _DEBUG_ENTITIES
-    LOG_DEBUG << "created entity " << Entity(uuid).toString();
+    LOG_DEBUG << "created " << count << " entities";
 #endif
 
-    return uuid;
+    Events::Dispatcher::raise<Events::EntitiesCreated>(ids);
+
+    return ids;
+}
+
+void EntityManager::destroyEntities(const std::vector<ID> &ids)
+{
+    // Check them all first so a bad ID doesn't leave the batch half done
+    std::vector<EntityRecord *> records;
+    records.reserve(ids.size());
+    for (auto id : ids)
+    {
+        auto record = findRecord(id);
+        if (!record)
+        {
+            throw Exceptions::NoSuchEntity(id);
+        }
+        records.push_back(record);
+    }
+
+    // Group by archetype so components can be destroyed a type at a time,
+    // dropping any entity that was asked for twice
+    std::sort(records.begin(), records.end(),
+              [](const EntityRecord *a, const EntityRecord *b)
+              {
+                  return a->archetype != b->archetype ?
+                      a->archetype < b->archetype : a->row < b->row;
+              });
+    records.erase(std::unique(records.begin(), records.end()), records.end());
+
+    for (auto first = records.begin(); first != records.end(); )
+    {
+        auto archetype = (*first)->archetype;
+        auto last = std::find_if(first, records.end(),
+                                 [archetype](const EntityRecord *r)
+                                     { return r->archetype != archetype; });
+
+        for (unsigned column = 0; column < archetype->getSignature().size(); column++)
+        {
+            for (auto i = first; i != last; i++)
+            {
+                delete archetype->getComponent((*i)->row, column);
+            }
+        }
+        first = last;
+    }
+
+    // Rows only start moving about once every component is gone, so note
+    // down who they belong to first
+    std::vector<ID> destroyed;
+    destroyed.reserve(records.size());
+    for (auto record : records)
+    {
+        destroyed.push_back(record->archetype->getEntity(record->row));
+    }
+
+    for (auto record : records)
+    {
+        eraseEntity(*record);
+    }
+
+    Events::Dispatcher::raise<Events::EntitiesDestroyed>(destroyed);
+}
+
+bool EntityManager::isAlive(ID id) const
+{
+    return findRecord(id) != nullptr;
+}
+
+Entity::ID EntityManager::reserveEntity()
+{
+    std::lock_guard<std::mutex> lock(_freeMutex);
+
+    if (!_freeIds.empty())
+    {
+        auto id = _freeIds.front();
+        _freeIds.pop_front();
+        return id;
+    }
+
+    if (_nextIndex > EntityID::MAX_INDEX)
+    {
+        throw Exceptions::TooManyEntities();
+    }
+    return ID(_nextIndex++, 0);
 }
 
-void EntityManager::destroyEntity(UUID uuid)
+std::vector<Entity::ID> EntityManager::reserveEntities(std::size_t count)
 {
-    // NOTE: there should be some more deconstruction here
+    std::vector<ID> ids;
+    ids.reserve(count);
 
-    auto iter = _map.find(uuid);
-    if (iter == _map.end())
+    std::lock_guard<std::mutex> lock(_freeMutex);
+    while (ids.size() < count && !_freeIds.empty())
     {
-        throw Exceptions::NoSuchEntity(uuid);
+        ids.push_back(_freeIds.front());
+        _freeIds.pop_front();
     }
-    _map.erase(iter);
+    if (_nextIndex + (count - ids.size()) > EntityID::MAX_INDEX + 1)
+    {
+        // Put back what we took
+        _freeIds.insert(_freeIds.begin(), ids.begin(), ids.end());
+        throw Exceptions::TooManyEntities();
+    }
+    while (ids.size() < count)
+    {
+        ids.push_back(ID(_nextIndex++, 0));
+    }
+    return ids;
+}
 
-    auto iter2 = _debugNameMap.find(uuid);
-    if (iter2 == _debugNameMap.end())
+void EntityManager::shrink()
+{
+    for (auto &pair : _archetypes)
     {
-        LOG_WARNING << "entity with UUID " << uuid << " existed in _map, but "
-                    << "not in _debugNameMap";
+        pair.second->shrink();
+    }
+}
+
+void EntityManager::setChangeTracking(bool enabled)
+{
+    _trackChanges = enabled;
+    _changedSlots.clear();
+    _changedIds.clear();
+    _destroyedIds.clear();
+}
+
+EntityManager::Changes EntityManager::takeChanges()
+{
+    Changes changes;
+    changes.changed.reserve(_changedIds.size());
+    for (auto id : _changedIds)
+    {
+        _changedSlots[id.getIndex()] = ID();
+        if (isAlive(id)) changes.changed.push_back(id);
+    }
+    _changedIds.clear();
+    changes.destroyed.swap(_destroyedIds);
+    return changes;
+}
+
+const uuid::uuid &EntityManager::getUUID(ID id)
+{
+    if (!findRecord(id))
+    {
+        throw Exceptions::NoSuchEntity(id);
+    }
+
+    auto iter = _uuids.find(id);
+    if (iter == _uuids.end())
+    {
+        auto uuid = uuid::generate();
+        iter = _uuids.emplace(id, uuid).first;
+        _entitiesByUUID[uuid] = id;
+    }
+    return iter->second;
+}
+
+bool EntityManager::hasUUID(ID id) const
+{
+    return _uuids.count(id) != 0;
+}
+
+void EntityManager::setUUID(ID id, const uuid::uuid &uuid)
+{
+    if (!findRecord(id))
+    {
+        throw Exceptions::NoSuchEntity(id);
+    }
+
+    auto iter = _uuids.find(id);
+    if (iter != _uuids.end())
+    {
+        _entitiesByUUID.erase(iter->second);
+        iter->second = uuid;
     }
     else
     {
-        _debugNameMap.erase(iter2);
+        _uuids.emplace(id, uuid);
     }
+    _entitiesByUUID[uuid] = id;
+}
 
-    Events::Dispatcher::raise<Events::EntityDestroyed>(uuid);
+Entity::ID EntityManager::findEntity(const uuid::uuid &uuid) const
+{
+    auto iter = _entitiesByUUID.find(uuid);
+    return iter == _entitiesByUUID.end() ? ID() : iter->second;
 }
 
 /*void EntityManager::onEvent(const Events::EntityCreated &event)
@@ -98,40 +336,383 @@ void EntityManager::destroyEntity(UUID uuid)
 void EntityManager::onEvent(const Events::ComponentCreated &event)
 {
     auto component = event.component;
+    // Registering a component is rare enough to afford the runtime lookup
+    auto type = TypeIds<Components::Component>::get(typeid(*component));
+
+    auto record = findRecord(component->getParent());
+    if (!record)
+    {
+        throw Exceptions::NoSuchEntity(component->getParent());
+    }
+
+    if (record->archetype->has(type))
+    {
+        throw Exceptions::ComponentExists(component);
+    }
 
-    try
+    moveEntity(*record, getArchetypeWith(record->archetype, type));
+    record->archetype->getComponent(record->row,
+                                    record->archetype->getColumn(type)) =
+        component;
+}
+
+CommandBuffer &EntityManager::getCommandBuffer()
+{
+    if (_id >= _threadCommandBuffers.size())
     {
-        auto &componentMap = _map.at(component->getParent());
-        if (componentMap.count(typeid(*component)))
+        _threadCommandBuffers.resize(_id + 1, nullptr);
+    }
+
+    auto &buffer = _threadCommandBuffers[_id];
+    if (!buffer)
+    {
+        std::lock_guard<std::mutex> lock(_commandBuffersMutex);
+        _commandBuffers.emplace_back(new CommandBuffer(*this));
+        buffer = _commandBuffers.back().get();
+    }
+    return *buffer;
+}
+
+void EntityManager::playback()
+{
+    typedef CommandBuffer::Op Op;
+    typedef CommandBuffer::Command Command;
+
+    std::vector<Command> commands;
+    std::vector<CommandBuffer::Change> changes;
+    {
+        std::lock_guard<std::mutex> lock(_commandBuffersMutex);
+        for (auto &buffer : _commandBuffers)
         {
-            throw Exceptions::ComponentExists(component);
+            std::move(buffer->_commands.begin(), buffer->_commands.end(),
+                      std::back_inserter(commands));
+            buffer->_commands.clear();
+            changes.insert(changes.end(), buffer->_changes.begin(),
+                           buffer->_changes.end());
+            buffer->_changes.clear();
         }
-        else
+    }
+    if (commands.empty() && changes.empty())
+    {
+        _version++;
+        return;
+    }
+
+    // Keeps each thread's commands of the same kind in the order they were
+    // recorded
+    std::stable_sort(commands.begin(), commands.end(),
+                     [](const Command &a, const Command &b)
+                         { return a.op < b.op; });
+
+    auto i = commands.begin();
+    auto upTo = [&commands, &i](Op op)
+    {
+        return std::find_if(i, commands.end(),
+                            [op](const Command &c) { return c.op > op; });
+    };
+
+    // Creations, batched like createEntities. Their IDs were reserved when
+    // they were recorded
+    auto end = upTo(Op::CreateEntity);
+    if (i != end)
+    {
+        auto count = static_cast<std::size_t>(end - i);
+        _emptyArchetype->reserve(_emptyArchetype->getSize() + count);
+
+        std::vector<ID> ids;
+        ids.reserve(count);
+        for (; i != end; i++)
         {
-            componentMap[typeid(*component)] = component;
+            insertEntity(i->id, i->debugName);
+            ids.push_back(i->id);
         }
+
+        Events::Dispatcher::raise<Events::EntitiesCreated>(std::move(ids));
     }
-    catch (std::out_of_range)
+
+    // Additions go through each component's create(), which raises the
+    // usual events. One that would clash is dropped before it's made rather
+    // than throwing and losing the rest of the batch
+    for (end = upTo(Op::AddComponent); i != end; i++)
     {
-        throw Exceptions::NoSuchEntity(component->getParent());
+        auto record = findRecord(i->id);
+        if (!record)
+        {
+            LOG_WARNING << "can't add component "
+                        << TypeIds<Components::Component>::getName(i->componentType)
+                        << " to entity " << i->id << ", it no longer exists";
+            continue;
+        }
+        if (record->archetype->has(i->componentType))
+        {
+            LOG_WARNING << "entity " << i->id << " already has component "
+                        << TypeIds<Components::Component>::getName(i->componentType);
+            continue;
+        }
+
+        i->create();
     }
-}
 
-const std::string &EntityManager::getDebugName(UUID uuid) const
-{
-    try
+    // Two systems may well have asked to remove the same thing
+    for (end = upTo(Op::RemoveComponent); i != end; i++)
     {
-        return _debugNameMap.at(uuid);
+        auto component = detachComponent(i->id, i->componentType);
+        if (!component)
+        {
+            LOG_WARNING << "entity " << i->id << " has no component "
+                        << TypeIds<Components::Component>::getName(i->componentType)
+                        << " to remove";
+        }
+        delete component;
     }
-    catch (std::out_of_range)
+
+    // Likewise destructions
+    std::vector<ID> ids;
+    for (; i != commands.end(); i++)
     {
-        throw Exceptions::NoSuchEntity(uuid);
+        if (isAlive(i->id))
+        {
+            ids.push_back(i->id);
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    if (!ids.empty()) destroyEntities(ids);
+
+    // Marks for entities or components that have since gone are dropped
+    for (auto &change : changes)
+    {
+        if (stampChanged(change.id, change.componentType))
+        {
+            noteChanged(change.id);
+        }
     }
+
+    _version++;
+}
+
+const std::string &EntityManager::getDebugName(ID id) const
+{
+    if (!findRecord(id))
+    {
+        throw Exceptions::NoSuchEntity(id);
+    }
+#ifdef _DEBUG_NAMES
+    return _debugNames[id.getIndex()].str();
+#else
+    return DebugName().str();
+#endif
 }
 
 std::string EntityManager::toString() const
 {
     std::ostringstream ss;
-    ss << "EntityManager[entityCount = " << _map.size() << "]";
+    ss << "EntityManager[entityCount = " << _entityCount
+       << ", archetypeCount = " << _archetypes.size() << "]";
     return ss.str();
 }
+
+EntityManager::EntityRecord *EntityManager::findRecord(ID id)
+{
+    auto index = id.getIndex();
+    if (index >= _records.size()) return nullptr;
+
+    auto &record = _records[index];
+    return record.archetype && record.id == id ? &record : nullptr;
+}
+
+const EntityManager::EntityRecord *EntityManager::findRecord(ID id) const
+{
+    return const_cast<EntityManager *>(this)->findRecord(id);
+}
+
+void EntityManager::noteChanged(ID id)
+{
+    if (!_trackChanges) return;
+
+    // Each slot remembers which ID it last listed, so an entity is only
+    // listed once however often it changes
+    auto index = id.getIndex();
+    if (index >= _changedSlots.size()) _changedSlots.resize(index + 1);
+    if (_changedSlots[index] != id)
+    {
+        _changedSlots[index] = id;
+        _changedIds.push_back(id);
+    }
+}
+
+bool EntityManager::stampChanged(ID id, Archetype::TypeId type)
+{
+    auto record = findRecord(id);
+    if (!record) return false;
+
+    auto column = record->archetype->getColumn(type);
+    if (column == Archetype::NO_COLUMN) return false;
+
+    record->archetype->setVersion(record->row, column, _version);
+    return true;
+}
+
+void EntityManager::insertEntity(ID id, DebugName debugName,
+                                 Archetype *archetype)
+{
+    if (!archetype) archetype = _emptyArchetype;
+
+    auto index = id.getIndex();
+    if (index >= _records.size())
+    {
+        _records.resize(index + 1, EntityRecord{nullptr, 0, ID()});
+#ifdef _DEBUG_NAMES
+        _debugNames.resize(index + 1);
+#endif
+    }
+
+    auto &record = _records[index];
+    assert(!record.archetype);
+    record.archetype = archetype;
+    record.row = archetype->addRow(id, _version);
+    record.id = id;
+    noteChanged(id);
+#ifdef _DEBUG_NAMES
+    _debugNames[index] = debugName;
+#endif
+    _entityCount++;
+}
+
+void EntityManager::eraseEntity(EntityRecord &record)
+{
+    auto id = record.id;
+
+    removeRow(record);
+    record.archetype = nullptr;
+#ifdef _DEBUG_NAMES
+    _debugNames[id.getIndex()] = DebugName();
+#endif
+    _entityCount--;
+
+    auto iter = _uuids.find(id);
+    if (iter != _uuids.end())
+    {
+        _entitiesByUUID.erase(iter->second);
+        _uuids.erase(iter);
+    }
+
+    if (_trackChanges) _destroyedIds.push_back(id);
+
+    std::lock_guard<std::mutex> lock(_freeMutex);
+    _freeIds.push_back(id.next());
+}
+
+Archetype *EntityManager::getArchetype(const Archetype::Signature &signature)
+{
+    auto &archetype = _archetypes[signature];
+    if (!archetype)
+    {
+        archetype.reset(new Archetype(signature));
+
+        for (auto type : signature)
+        {
+            if (type >= _archetypesWith.size()) _archetypesWith.resize(type + 1);
+            _archetypesWith[type].push_back(archetype.get());
+        }
+
+        // Entities coming and going within existing archetypes are picked up
+        // by queries for free, it's only new archetypes they need telling of
+        for (auto &query : _queries)
+        {
+            if (query) query->match(archetype.get());
+        }
+
+#ifdef _DEBUG_ENTITIES
+        LOG_DEBUG << "created " << archetype->toString();
+#endif
+    }
+    return archetype.get();
+}
+
+Archetype *EntityManager::getArchetypeWith(Archetype *from,
+                                           Archetype::TypeId type)
+{
+    auto to = from->getAddEdge(type);
+    if (!to)
+    {
+        auto signature = from->getSignature();
+        signature.insert(std::lower_bound(signature.begin(), signature.end(),
+                                          type),
+                         type);
+        to = getArchetype(signature);
+
+        from->setAddEdge(type, to);
+        to->setRemoveEdge(type, from);
+    }
+    return to;
+}
+
+Archetype *EntityManager::getArchetypeWithout(Archetype *from,
+                                              Archetype::TypeId type)
+{
+    auto to = from->getRemoveEdge(type);
+    if (!to)
+    {
+        auto signature = from->getSignature();
+        signature.erase(std::lower_bound(signature.begin(), signature.end(),
+                                         type));
+        to = getArchetype(signature);
+
+        from->setRemoveEdge(type, to);
+        to->setAddEdge(type, from);
+    }
+    return to;
+}
+
+void EntityManager::moveEntity(EntityRecord &record, Archetype *to)
+{
+    auto from = record.archetype;
+    auto row = to->addRow(record.id, _version);
+
+    // Carry over every component the two archetypes have in common, along
+    // with when it last changed. Both signatures are sorted, so walk them
+    // side by side
+    auto &fromSig = from->getSignature();
+    auto &toSig = to->getSignature();
+    unsigned i = 0, j = 0;
+    while (i < fromSig.size() && j < toSig.size())
+    {
+        if (fromSig[i] < toSig[j]) i++;
+        else if (toSig[j] < fromSig[i]) j++;
+        else
+        {
+            to->getComponent(row, j) = from->getComponent(record.row, i);
+            to->setVersion(row, j++, from->getVersion(record.row, i++));
+        }
+    }
+
+    removeRow(record);
+    record.archetype = to;
+    record.row = row;
+    noteChanged(record.id);
+}
+
+Components::Component *EntityManager::detachComponent(ID id,
+                                                      Archetype::TypeId type)
+{
+    auto record = findRecord(id);
+    if (!record) return nullptr;
+
+    auto column = record->archetype->getColumn(type);
+    if (column == Archetype::NO_COLUMN) return nullptr;
+
+    auto component = record->archetype->getComponent(record->row, column);
+    moveEntity(*record, getArchetypeWithout(record->archetype, type));
+    return component;
+}
+
+void EntityManager::removeRow(const EntityRecord &record)
+{
+    // Whichever entity got moved into the hole needs its record updating
+    ID moved;
+    if (record.archetype->removeRow(record.row, moved))
+    {
+        _records[moved.getIndex()].row = record.row;
+    }
+}
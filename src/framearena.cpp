@@ -0,0 +1,133 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "framearena.h"
+
+#include <algorithm>
+#include <new>
+#include <sstream>
+
+namespace
+{
+    thread_local FrameArena *_current = nullptr;
+
+    // Block headers are padded so the data after them is maximally aligned
+    constexpr std::size_t HEADER_SIZE =
+        (sizeof(void *) * 2 + alignof(std::max_align_t) - 1) /
+        alignof(std::max_align_t) * alignof(std::max_align_t);
+}
+
+FrameArena::FrameArena(std::size_t blockSize) :
+    _blocks(nullptr),
+    _cursor(nullptr),
+    _limit(nullptr),
+    _blockSize(blockSize),
+    _bytesUsed(0),
+    _lastFrameBytes(0),
+    _peakFrameBytes(0)
+{
+    addBlock(_blockSize);
+}
+
+FrameArena::~FrameArena()
+{
+    if (_current == this) _current = nullptr;
+    releaseBlocks();
+}
+
+void FrameArena::reset()
+{
+    _lastFrameBytes = _bytesUsed;
+    _peakFrameBytes = std::max(_peakFrameBytes, _bytesUsed);
+
+    // If the last frame spilled into more than one block, replace them all
+    // with one that would have held everything
+    if (_blocks && _blocks->next)
+    {
+        std::size_t total = 0;
+        for (auto block = _blocks; block; block = block->next)
+        {
+            total += block->size;
+        }
+
+        releaseBlocks();
+        _blockSize = std::max(_blockSize, total);
+        addBlock(_blockSize);
+    }
+    else if (_blocks)
+    {
+        _cursor = reinterpret_cast<unsigned char *>(_blocks) + HEADER_SIZE;
+    }
+
+    _bytesUsed = 0;
+}
+
+std::string FrameArena::toString() const
+{
+    std::ostringstream ss;
+    ss << "FrameArena[blockSize = " << _blockSize
+       << ", bytesUsed = " << _bytesUsed
+       << ", lastFrameBytes = " << _lastFrameBytes
+       << ", peakFrameBytes = " << _peakFrameBytes << "]";
+    return ss.str();
+}
+
+FrameArena *FrameArena::getCurrent()
+{
+    return _current;
+}
+
+void FrameArena::setCurrent(FrameArena *arena)
+{
+    _current = arena;
+}
+
+void *FrameArena::allocateSlow(std::size_t size, std::size_t alignment)
+{
+    // Chain on a block that's guaranteed to fit this allocation
+    addBlock(std::max(_blockSize, size + alignment));
+
+    auto p = allocate(size, alignment);
+    assert(p);
+    return p;
+}
+
+void FrameArena::addBlock(std::size_t size)
+{
+    auto raw = static_cast<unsigned char *>(::operator new(HEADER_SIZE + size));
+
+    auto block = reinterpret_cast<Block *>(raw);
+    block->next = _blocks;
+    block->size = size;
+    _blocks = block;
+
+    _cursor = raw + HEADER_SIZE;
+    _limit = _cursor + size;
+}
+
+void FrameArena::releaseBlocks()
+{
+    while (_blocks)
+    {
+        auto next = _blocks->next;
+        ::operator delete(_blocks);
+        _blocks = next;
+    }
+
+    _cursor = nullptr;
+    _limit = nullptr;
+}
@@ -29,7 +29,12 @@
 #include <iostream>
 #include <sstream>
 
+#include "components/camera.h"
+#include "components/light.h"
 #include "logger.h"
+#include "ogrelog.h"
+#include "poolregistry.h"
+#include "snapshot.h"
 
 namespace fs = boost::filesystem;
 
@@ -38,13 +43,21 @@ Game::Game(const Options &options) :
     _running(false),
     _window(nullptr),
     _inputMgr(nullptr),
+    _jobSystem(nullptr),
     _entityMgr(nullptr),
+    _scheduler(nullptr),
+    _autosaver(nullptr),
+    _autosaveTimer(0),
 	_root(nullptr),
 	_resourcesCfg(Ogre::BLANKSTRING),
 	_pluginsCfg(Ogre::BLANKSTRING)
 {
-    Logger::init(options.logFile, options.suppressOgreLog);
+    Logger::init(options.logFile);
+    Logger::initOgreLog(options.suppressOgreLog);
     Events::Dispatcher::subscribe<Events::Quit>(*this);
+
+    // Transient allocations on the main thread go to the frame arena
+    FrameArena::setCurrent(&_frameArena);
 }
 
 void Game::run()
@@ -64,13 +77,40 @@ void Game::run()
 
     _window = new Window();
     _inputMgr = new InputManager();
+    // Workers have to be up before anything might hand them jobs
+    _jobSystem = new JobSystem();
     _entityMgr = new EntityManager();
+    EntityManager::setCurrent(_entityMgr);
+    _scheduler = new Scheduler(*_jobSystem);
+
+    // Component types that can be saved to and loaded from snapshots
+    Snapshot::registerType<Components::Camera>();
+    Snapshot::registerType<Components::Light>();
+
+    if (_options.autosaveInterval > 0)
+    {
+        _autosaver = new Autosaver(*_entityMgr, _options.autosaveFile);
+    }
     
     debugSetup();
+    _root->addFrameListener(this);
     _root->startRendering();
+    _root->removeFrameListener(this);
     //std::cin.get();
+
+    // Log pool usage so capacities can be sized from real sessions
+    PoolRegistry::dump();
+    LOG_INFO << _frameArena;
     
+    // Finishes writing any autosave still in flight
+    delete _autosaver;
+    delete _scheduler;
     delete _entityMgr;
+    delete _jobSystem;
+
+    // Everything allocated during the session should be back by now
+    PoolRegistry::reportLeaks();
+
     delete _inputMgr;
     delete _window;
 	delete _root;
@@ -160,4 +200,24 @@ void Game::debugSetup()
 
 bool Game::frameRenderingQueued(const Ogre::FrameEvent &e)
 {
+    // Everything allocated in the arena last frame is now garbage
+    _frameArena.reset();
+
+    _scheduler->update(e.timeSinceLastFrame);
+
+    // Sync point: apply whatever the systems queued up
+    _entityMgr->playback();
+
+    // Nothing's running between frames, so the world can be captured now
+    if (_autosaver)
+    {
+        _autosaveTimer += e.timeSinceLastFrame;
+        if (_autosaveTimer >= _options.autosaveInterval)
+        {
+            _autosaveTimer = 0;
+            _autosaver->save();
+        }
+    }
+
+    return true;
 }
@@ -0,0 +1,269 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "jobsystem.h"
+
+#include <new>
+#include <sstream>
+
+#include "logger.h"
+
+namespace
+{
+    struct CurrentWorker
+    {
+        const JobSystem *system;
+        unsigned index;
+    };
+
+    thread_local CurrentWorker _current = { nullptr, JobSystem::NOT_A_WORKER };
+}
+
+JobSystem::JobSystem(unsigned threadCount) :
+    _injectedCount(0),
+    _queued(0),
+    _sleepers(0),
+    _stopping(false)
+{
+    if (!threadCount)
+    {
+        threadCount = std::max(1u, boost::thread::hardware_concurrency());
+    }
+
+    // All the deques have to exist before any worker goes looking to steal
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        _workers.emplace_back(new Worker());
+    }
+
+    _current = { this, 0 };
+    for (unsigned i = 1; i < threadCount; i++)
+    {
+        _workers[i]->thread = boost::thread(&JobSystem::workerLoop, this, i);
+    }
+
+    LOG_INFO << "job system running on " << threadCount << " threads";
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(_sleepMutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+
+    for (unsigned i = 1; i < _workers.size(); i++)
+    {
+        _workers[i]->thread.join();
+    }
+
+    // Anything left over never got waited on
+    for (auto &worker : _workers)
+    {
+        while (auto job = worker->deque.pop()) releaseJob(job);
+    }
+    for (auto job : _injected) releaseJob(job);
+
+    if (_current.system == this) _current = { nullptr, NOT_A_WORKER };
+}
+
+void JobSystem::run(Function fn, JobCounter *counter)
+{
+    if (counter) counter->_count.fetch_add(1, std::memory_order_relaxed);
+    queue(std::move(fn), counter);
+}
+
+void JobSystem::runAfter(JobCounter &dependency, Function fn,
+                         JobCounter *counter)
+{
+    if (counter) counter->_count.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        boost::lock_guard<boost::mutex> lock(dependency._mutex);
+
+        // Only flag the dependency while it still has jobs to finish, so
+        // that whichever finishes last is sure to see the flag
+        auto count = dependency._count.load(std::memory_order_acquire);
+        while (count & ~JobCounter::FOLLOWED)
+        {
+            if (dependency._count.compare_exchange_weak(
+                    count, count | JobCounter::FOLLOWED,
+                    std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                dependency._followers.emplace_back(std::move(fn), counter);
+                return;
+            }
+        }
+    }
+
+    queue(std::move(fn), counter);
+}
+
+void JobSystem::queue(Function fn, JobCounter *counter)
+{
+    // Spill to the heap when the pool runs dry; checked rather than caught
+    // since a burst of jobs can overflow it thousands of times per frame
+    Job *job;
+    if (auto slot = _jobPool.tryAllocate())
+    {
+        job = new (slot) Job{ std::move(fn), counter, true };
+    }
+    else
+    {
+        job = new Job{ std::move(fn), counter, false };
+    }
+
+    // Counted before it's visible so _queued never dips below zero. Pairs
+    // with the sleeper count going up before a worker checks _queued, so
+    // either the worker sees this job or we see the worker and wake it
+    _queued.fetch_add(1);
+
+    if (_current.system == this)
+    {
+        _workers[_current.index]->deque.push(job);
+    }
+    else
+    {
+        boost::lock_guard<boost::mutex> lock(_injectedMutex);
+        _injected.push_back(job);
+        _injectedCount.fetch_add(1, std::memory_order_release);
+    }
+
+    if (_sleepers.load())
+    {
+        boost::lock_guard<boost::mutex> lock(_sleepMutex);
+        _wake.notify_one();
+    }
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+    auto index = _current.system == this ? _current.index : NOT_A_WORKER;
+
+    while (!counter.isDone())
+    {
+        Job *job = index != NOT_A_WORKER ? findJob(index) : nullptr;
+        if (job)
+        {
+            execute(job);
+        }
+        else
+        {
+            boost::this_thread::yield();
+        }
+    }
+}
+
+unsigned JobSystem::getWorkerIndex()
+{
+    return _current.index;
+}
+
+std::string JobSystem::toString() const
+{
+    std::ostringstream ss;
+    ss << "JobSystem[threads = " << _workers.size()
+       << ", queued = " << _queued.load(std::memory_order_relaxed) << "]";
+    return ss.str();
+}
+
+void JobSystem::workerLoop(unsigned index)
+{
+    _current = { this, index };
+
+    while (!_stopping.load(std::memory_order_relaxed))
+    {
+        if (auto job = findJob(index))
+        {
+            execute(job);
+            continue;
+        }
+
+        boost::unique_lock<boost::mutex> lock(_sleepMutex);
+        _sleepers.fetch_add(1);
+        _wake.wait(lock, [this] { return _stopping || _queued.load() > 0; });
+        _sleepers.fetch_sub(1);
+    }
+}
+
+JobSystem::Job *JobSystem::findJob(unsigned index)
+{
+    Job *job = _workers[index]->deque.pop();
+
+    if (!job && _injectedCount.load(std::memory_order_acquire))
+    {
+        boost::lock_guard<boost::mutex> lock(_injectedMutex);
+        if (!_injected.empty())
+        {
+            job = _injected.front();
+            _injected.pop_front();
+            _injectedCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Go round everyone else, starting with our neighbour
+    auto count = static_cast<unsigned>(_workers.size());
+    for (unsigned i = 1; !job && i < count; i++)
+    {
+        job = _workers[(index + i) % count]->deque.steal();
+    }
+
+    if (job) _queued.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+void JobSystem::execute(Job *job)
+{
+    job->fn();
+
+    auto counter = job->counter;
+    releaseJob(job);
+    if (counter) finish(*counter);
+}
+
+void JobSystem::finish(JobCounter &counter)
+{
+    auto left = counter._count.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    if (left != JobCounter::FOLLOWED) return;
+
+    // Last one out, with jobs waiting on the counter. They're queued before
+    // the flag comes off, since whoever's waiting on the counter is free to
+    // destroy it as soon as it reads zero
+    decltype(counter._followers) followers;
+    {
+        boost::lock_guard<boost::mutex> lock(counter._mutex);
+        followers.swap(counter._followers);
+    }
+    for (auto &follower : followers)
+    {
+        queue(std::move(follower.first), follower.second);
+    }
+    counter._count.fetch_sub(JobCounter::FOLLOWED, std::memory_order_release);
+}
+
+void JobSystem::releaseJob(Job *job)
+{
+    if (job->pooled)
+    {
+        job->~Job();
+        _jobPool.release(job);
+    }
+    else
+    {
+        delete job;
+    }
+}
@@ -27,20 +27,12 @@
 #include <boost/log/utility/setup.hpp>
 #include <fstream>
 #include <iostream>
-#include <OgreLogManager.h>
 
 namespace bl = boost::log;
 namespace attr = bl::attributes;
 namespace expr = bl::expressions;
 namespace src = bl::sources;
 
-namespace
-{
-    bool _suppressOgreLog;
-    void initOgreLog();
-    Logger::OgreLogListener *getLogListener();
-}
-
 namespace Logger::Severity
 {
     // It's a bit kludgy to include formatting in the SeverityType strings,
@@ -69,7 +61,7 @@ BOOST_LOG_GLOBAL_LOGGER_INIT(gLog, src::severity_logger_mt<Logger::SeverityType>
     return lg;
 }
 
-void Logger::init(const std::string &logFile, bool suppressOgreLog)
+void Logger::init(const std::string &logFile)
 {    
     bl::core::get()->add_global_attribute("TimeStamp", attr::local_clock());
     
@@ -101,69 +93,9 @@ void Logger::init(const std::string &logFile, bool suppressOgreLog)
 #endif
 
     bl::core::get()->add_sink(sink);
-    
-    _suppressOgreLog = suppressOgreLog;
-    initOgreLog();
 }
 
 void Logger::destroy()
 {
     bl::core::get()->remove_all_sinks();
 }
-
-// Forward all OGRE messages to the default logger
-void Logger::OgreLogListener::messageLogged(
-    const Ogre::String &message,
-    Ogre::LogMessageLevel lml,
-    bool maskDebug,
-    const Ogre::String &logName,
-    bool &skipThisMessage)
-{
-    if (!_suppressOgreLog)
-    {
-        switch (lml)
-        {
-        case Ogre::LML_TRIVIAL:
-            LOG_OGRE_TRIVIAL << message;
-            break;
-            
-        case Ogre::LML_NORMAL:
-            LOG_OGRE_NORMAL << message;
-            break;
-            
-        case Ogre::LML_WARNING:
-            LOG_OGRE_WARNING << message;
-            break;
-            
-        case Ogre::LML_CRITICAL:
-            LOG_OGRE_CRITICAL << message;
-            break;
-            
-        default:
-            LOG_WARNING << "Unknown OGRE log message: " << message;
-        }
-    }
-    
-    skipThisMessage = true;
-}
-
-namespace {
-    
-void initOgreLog()
-{
-    // First, create a LogManager and custom log, suppressing file output
-    auto logMgr = new Ogre::LogManager();
-    logMgr->setLogDetail(Ogre::LL_LOW); // LL_NORMAL, LL_BOREME
-    auto log = logMgr->createLog("ogre.log", true, true, true);
-    
-    // Next, create the custom listener to act as a sink for OGRE messages
-    log->addListener(getLogListener());
-}
-
-Logger::OgreLogListener *getLogListener()
-{
-    static Logger::OgreLogListener listener;
-    return &listener;
-}
-
-}
@@ -78,6 +78,9 @@ Game::Options parseArgs(int argc, char *argv[])
     std::ostringstream defaultLogFile;
     defaultLogFile << "logs/" << options.programName << ".txt";
 
+    std::ostringstream defaultAutosaveFile;
+    defaultAutosaveFile << "saves/" << options.programName << ".snap";
+
     po::options_description desc("Allowed options");
     desc.add_options()
         ("help", "produce help message")
@@ -85,7 +88,9 @@ Game::Options parseArgs(int argc, char *argv[])
         ("height,h", po::value<unsigned>(&options.windowHeight)->default_value(DEFAULT_WINDOW_HEIGHT), "set window height")
         ("log-file", po::value<std::string>(&options.logFile)->default_value(defaultLogFile.str()), "set output log file")
         ("suppress-ogre-log,q", po::bool_switch(&options.suppressOgreLog)->default_value(false), "suppress OGRE log output")
-        ("config-dialog,c", po::bool_switch(&options.showConfigDialog)->default_value(false), "always show config dialog");
+        ("config-dialog,c", po::bool_switch(&options.showConfigDialog)->default_value(false), "always show config dialog")
+        ("autosave-file", po::value<std::string>(&options.autosaveFile)->default_value(defaultAutosaveFile.str()), "set autosave file")
+        ("autosave-interval", po::value<float>(&options.autosaveInterval)->default_value(0), "set seconds between autosaves, 0 to disable");
 
     po::variables_map map;
     po::store(po::parse_command_line(argc, argv, desc), map);
@@ -106,6 +111,8 @@ Game::Options parseArgs(int argc, char *argv[])
     options.windowWidth = DEFAULT_WINDOW_WIDTH;
     options.suppressOgreLog = false;
     options.showConfigDialog = false;
+    options.autosaveFile = "saves/tile.snap";
+    options.autosaveInterval = 0;
 #endif
 
     return options;
@@ -0,0 +1,90 @@
+/* game
+ * Copyright (C) 2014-2016 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ogrelog.h"
+
+#include <OgreLogManager.h>
+
+namespace
+{
+    bool _suppressOgreLog;
+    void createOgreLog();
+    Logger::OgreLogListener *getLogListener();
+}
+
+void Logger::initOgreLog(bool suppress)
+{
+    _suppressOgreLog = suppress;
+    createOgreLog();
+}
+
+// Forward all OGRE messages to the default logger
+void Logger::OgreLogListener::messageLogged(
+    const Ogre::String &message,
+    Ogre::LogMessageLevel lml,
+    bool maskDebug,
+    const Ogre::String &logName,
+    bool &skipThisMessage)
+{
+    if (!_suppressOgreLog)
+    {
+        switch (lml)
+        {
+        case Ogre::LML_TRIVIAL:
+            LOG_OGRE_TRIVIAL << message;
+            break;
+            
+        case Ogre::LML_NORMAL:
+            LOG_OGRE_NORMAL << message;
+            break;
+            
+        case Ogre::LML_WARNING:
+            LOG_OGRE_WARNING << message;
+            break;
+            
+        case Ogre::LML_CRITICAL:
+            LOG_OGRE_CRITICAL << message;
+            break;
+            
+        default:
+            LOG_WARNING << "Unknown OGRE log message: " << message;
+        }
+    }
+    
+    skipThisMessage = true;
+}
+
+namespace {
+    
+void createOgreLog()
+{
+    // First, create a LogManager and custom log, suppressing file output
+    auto logMgr = new Ogre::LogManager();
+    logMgr->setLogDetail(Ogre::LL_LOW); // LL_NORMAL, LL_BOREME
+    auto log = logMgr->createLog("ogre.log", true, true, true);
+    
+    // Next, create the custom listener to act as a sink for OGRE messages
+    log->addListener(getLogListener());
+}
+
+Logger::OgreLogListener *getLogListener()
+{
+    static Logger::OgreLogListener listener;
+    return &listener;
+}
+
+}
@@ -0,0 +1,155 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "poolmemory.h"
+
+#include <cassert>
+#include <new>
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <sys/mman.h>
+#endif
+
+#include "logger.h"
+
+namespace
+{
+    inline std::size_t roundUp(std::size_t size, std::size_t multiple)
+    {
+        return (size + multiple - 1) / multiple * multiple;
+    }
+
+    void *allocateHugePages(std::size_t size, PoolMemory::Source &source);
+    void releasePages(void *data, std::size_t size);
+}
+
+PoolMemory::Block PoolMemory::allocate(std::size_t size,
+                                       std::size_t alignment,
+                                       bool hugePages)
+{
+    assert(alignment && !(alignment & (alignment - 1)));
+
+    Block block;
+    block.alignment = alignment;
+
+    // Huge pages are only worth it when the pool fills at least one of them.
+    // Pages are always aligned far beyond anything a slot asks for
+    if (hugePages && size >= HUGE_PAGE_SIZE && alignment <= HUGE_PAGE_SIZE)
+    {
+        block.size = roundUp(size, HUGE_PAGE_SIZE);
+        block.data = allocateHugePages(block.size, block.source);
+        if (block.data) return block;
+
+        LOG_WARNING << "could not map " << block.size << " bytes of pool "
+                    << "memory, falling back to the heap";
+    }
+
+    block.size = size;
+    block.data = ::operator new(size, std::align_val_t(alignment));
+    block.source = Source::Heap;
+    return block;
+}
+
+void PoolMemory::release(Block &block) noexcept
+{
+    switch (block.source)
+    {
+    case Source::None:
+        break;
+
+    case Source::Heap:
+        ::operator delete(block.data, std::align_val_t(block.alignment));
+        break;
+
+    case Source::Pages:
+    case Source::HugePages:
+        releasePages(block.data, block.size);
+        break;
+    }
+
+    block = Block();
+}
+
+namespace {
+
+#ifdef _WIN32
+
+void *allocateHugePages(std::size_t size, PoolMemory::Source &source)
+{
+    // Large pages need SeLockMemoryPrivilege, which most accounts don't have
+    auto largePage = GetLargePageMinimum();
+    if (largePage && size % largePage == 0)
+    {
+        auto p = VirtualAlloc(nullptr, size,
+                              MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                              PAGE_READWRITE);
+        if (p)
+        {
+            source = PoolMemory::Source::HugePages;
+            return p;
+        }
+    }
+
+    auto p = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT,
+                          PAGE_READWRITE);
+    if (p) source = PoolMemory::Source::Pages;
+    return p;
+}
+
+void releasePages(void *data, std::size_t size)
+{
+    VirtualFree(data, 0, MEM_RELEASE);
+}
+
+#else
+
+void *allocateHugePages(std::size_t size, PoolMemory::Source &source)
+{
+#ifdef MAP_HUGETLB
+    // Explicit huge pages only work if the admin has reserved some
+    auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED)
+    {
+        source = PoolMemory::Source::HugePages;
+        return p;
+    }
+#endif
+
+    // Otherwise ask for transparent huge pages on a regular mapping
+    auto p2 = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p2 == MAP_FAILED) return nullptr;
+
+#ifdef MADV_HUGEPAGE
+    madvise(p2, size, MADV_HUGEPAGE);
+#endif
+
+    source = PoolMemory::Source::Pages;
+    return p2;
+}
+
+void releasePages(void *data, std::size_t size)
+{
+    munmap(data, size);
+}
+
+#endif
+
+}
@@ -0,0 +1,150 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "poolregistry.h"
+
+#include <algorithm>
+#include <cassert>
+#include <boost/core/demangle.hpp>
+#include <mutex>
+#include <sstream>
+
+#include "logger.h"
+
+namespace
+{
+    // Pools are often function-local statics, so the registry has to be
+    // constructed on first use to be sure it outlives all of them
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<const PoolBase *> pools;
+    };
+
+    Registry &getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+}
+
+PoolBase::PoolBase(const std::type_info &type, const char *kind) :
+    _typeName(boost::core::demangle(type.name())),
+    _kind(kind),
+    _registered(false)
+{
+}
+
+PoolBase::~PoolBase()
+{
+    assert(!_registered && "pool destructor didn't call unregisterPool()");
+    unregisterPool();
+}
+
+void PoolBase::registerPool()
+{
+    assert(!_registered);
+    PoolRegistry::add(this);
+    _registered = true;
+}
+
+void PoolBase::unregisterPool()
+{
+    if (!_registered) return;
+    PoolRegistry::remove(this);
+    _registered = false;
+}
+
+std::string PoolBase::toString() const
+{
+    auto stats = getStats();
+
+    std::ostringstream ss;
+    ss << _kind << "<" << _typeName << ">"
+       << "[capacity = " << stats.capacity
+       << ", live = " << stats.live
+       << ", peak = " << stats.peak
+       << ", allocations = " << stats.allocations
+       << ", releases = " << stats.releases
+       << ", failures = " << stats.failures << "]";
+    return ss.str();
+}
+
+std::vector<PoolRegistry::Entry> PoolRegistry::snapshot()
+{
+    auto &registry = getRegistry();
+    std::vector<Entry> entries;
+
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        entries.reserve(registry.pools.size());
+        for (auto pool : registry.pools)
+        {
+            entries.push_back({ pool->getTypeName(), pool->getKind(),
+                                pool->getStats() });
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry &a, const Entry &b)
+                  { return a.typeName < b.typeName; });
+    return entries;
+}
+
+void PoolRegistry::dump()
+{
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    LOG_INFO << registry.pools.size() << " live pools";
+    for (auto pool : registry.pools)
+    {
+        LOG_INFO << "    " << pool;
+    }
+}
+
+std::size_t PoolRegistry::reportLeaks()
+{
+    std::size_t leaked = 0;
+    for (auto &entry : snapshot())
+    {
+        if (!entry.stats.live) continue;
+
+        LOG_WARNING << entry.stats.live << " objects never released from "
+                    << entry.kind << "<" << entry.typeName << ">";
+        leaked += entry.stats.live;
+    }
+
+    if (!leaked) LOG_INFO << "no objects left in any pool";
+    return leaked;
+}
+
+void PoolRegistry::add(const PoolBase *pool)
+{
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.pools.push_back(pool);
+}
+
+void PoolRegistry::remove(const PoolBase *pool)
+{
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto &pools = registry.pools;
+    pools.erase(std::remove(pools.begin(), pools.end(), pool), pools.end());
+}
@@ -0,0 +1,240 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "scheduler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "logger.h"
+
+namespace
+{
+    bool intersects(const std::vector<unsigned> &a,
+                    const std::vector<unsigned> &b)
+    {
+        for (auto type : a)
+        {
+            if (std::find(b.begin(), b.end(), type) != b.end()) return true;
+        }
+        return false;
+    }
+}
+
+bool System::conflictsWith(const System &other) const
+{
+    return intersects(_writes, other._writes) ||
+           intersects(_writes, other._reads) ||
+           intersects(_reads, other._writes);
+}
+
+std::string System::toString() const
+{
+    auto names = [](const std::vector<unsigned> &types)
+    {
+        std::ostringstream ss;
+        for (auto i = types.begin(); i != types.end(); i++)
+        {
+            if (i != types.begin()) ss << ", ";
+            ss << TypeIds<Components::Component>::getName(*i);
+        }
+        return ss.str();
+    };
+
+    std::ostringstream ss;
+    ss << "System[name = \"" << _name << "\", reads = {" << names(_reads)
+       << "}, writes = {" << names(_writes) << "}]";
+    return ss.str();
+}
+
+Scheduler::Scheduler(JobSystem &jobs) :
+    _jobs(jobs),
+    _dirty(false),
+    _dt(0)
+{
+}
+
+System *Scheduler::add(std::unique_ptr<System> system)
+{
+    auto ptr = system.get();
+
+    Node node;
+    node.system = std::move(system);
+    node.thread = 0;
+    node.start = node.end = 0;
+    _nodes.push_back(std::move(node));
+    _dirty = true;
+
+#ifdef _DEBUG_SCHEDULER
+    LOG_DEBUG << "added " << ptr;
+#endif
+
+    return ptr;
+}
+
+void Scheduler::remove(System *system)
+{
+    auto i = std::find_if(_nodes.begin(), _nodes.end(),
+                          [system](const Node &node)
+                              { return node.system.get() == system; });
+    if (i != _nodes.end())
+    {
+        _nodes.erase(i);
+        _dirty = true;
+    }
+}
+
+void Scheduler::update(float dt)
+{
+    if (_nodes.empty()) return;
+
+    bool rebuilt = _dirty;
+    if (_dirty) buildGraph();
+
+    _dt = dt;
+    _error = nullptr;
+    _frameStart = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < _nodes.size(); i++)
+    {
+        _pending[i].store(static_cast<unsigned>(_nodes[i].dependencies.size()),
+                          std::memory_order_relaxed);
+    }
+
+    // Systems with nothing to wait on start straight away, the rest are
+    // queued by whichever dependency finishes last
+    for (unsigned i = 0; i < _nodes.size(); i++)
+    {
+        if (_nodes[i].dependencies.empty()) submit(i);
+    }
+    _jobs.wait(_counter);
+
+    auto error = _error;
+
+#ifdef _DEBUG_SCHEDULER
+    if (rebuilt)
+    {
+        LOG_DEBUG << getSchedule();
+    }
+#else
+    (void)rebuilt;
+#endif
+
+    if (error) std::rethrow_exception(error);
+}
+
+std::string Scheduler::getSchedule() const
+{
+    std::size_t width = 0;
+    for (auto &node : _nodes)
+    {
+        width = std::max(width, node.system->getName().size());
+    }
+
+    std::ostringstream ss;
+    ss << "schedule for " << _nodes.size() << " systems on "
+       << getThreadCount() << " threads:";
+    for (auto &node : _nodes)
+    {
+        ss << "\n    " << std::left << std::setw(static_cast<int>(width))
+           << node.system->getName() << std::right
+           << "  thread " << std::setw(2) << node.thread
+           << "  " << std::setw(8) << node.start << "us - "
+           << std::setw(8) << node.end << "us";
+
+        if (!node.dependencies.empty())
+        {
+            ss << "  after ";
+            for (auto i = node.dependencies.begin();
+                 i != node.dependencies.end(); i++)
+            {
+                if (i != node.dependencies.begin()) ss << ", ";
+                ss << _nodes[*i].system->getName();
+            }
+        }
+    }
+    return ss.str();
+}
+
+std::string Scheduler::toString() const
+{
+    std::ostringstream ss;
+    ss << "Scheduler[systems = " << _nodes.size()
+       << ", threads = " << getThreadCount() << "]";
+    return ss.str();
+}
+
+void Scheduler::buildGraph()
+{
+    for (auto &node : _nodes)
+    {
+        node.dependencies.clear();
+        node.dependents.clear();
+    }
+
+    // Each system waits on every earlier system it conflicts with. Edges
+    // that are implied by others are kept, there are never many systems
+    for (unsigned j = 0; j < _nodes.size(); j++)
+    {
+        for (unsigned i = 0; i < j; i++)
+        {
+            if (_nodes[j].system->conflictsWith(*_nodes[i].system))
+            {
+                _nodes[j].dependencies.push_back(i);
+                _nodes[i].dependents.push_back(j);
+            }
+        }
+    }
+
+    _pending.reset(new std::atomic<unsigned>[_nodes.size()]);
+    _dirty = false;
+}
+
+void Scheduler::submit(unsigned node)
+{
+    _jobs.run([this, node] { runNode(node); }, &_counter);
+}
+
+void Scheduler::runNode(unsigned index)
+{
+    auto &node = _nodes[index];
+
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        node.system->update(_dt);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(_errorMutex);
+        if (!_error) _error = std::current_exception();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    node.thread = JobSystem::getWorkerIndex();
+    node.start = duration_cast<microseconds>(start - _frameStart).count();
+    node.end = duration_cast<microseconds>(end - _frameStart).count();
+
+    for (auto dependent : node.dependents)
+    {
+        if (_pending[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            submit(dependent);
+        }
+    }
+}
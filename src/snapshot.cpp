@@ -0,0 +1,634 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "snapshot.h"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <fstream>
+
+#include "entitymanager.h"
+#include "logger.h"
+
+namespace
+{
+    const char MAGIC[4] = { 'O', 'G', 'S', 'N' };
+
+    enum Kind : std::uint32_t
+    {
+        FULL,
+        DELTA
+    };
+
+    // Marks component types in the type table while saving
+    const std::uint32_t NOT_SEEN = ~0u;
+    const std::uint32_t SKIPPED = ~0u - 1;
+}
+
+void SnapshotWriter::write(const std::string &value)
+{
+    write(static_cast<std::uint32_t>(value.size()));
+    writeBytes(value.data(), value.size());
+}
+
+void SnapshotWriter::writeBytes(const void *data, std::size_t size)
+{
+    auto bytes = static_cast<const char *>(data);
+    _data.insert(_data.end(), bytes, bytes + size);
+}
+
+void SnapshotWriter::writeFile(const std::string &path) const
+{
+    auto temp = path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        file.write(_data.data(), _data.size());
+        if (!file)
+        {
+            throw Exceptions::BadSnapshot(path, "couldn't write file");
+        }
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::rename(temp, path, error);
+    if (error)
+    {
+        throw Exceptions::BadSnapshot(path, error.message());
+    }
+}
+
+std::string SnapshotReader::readString()
+{
+    auto size = read<std::uint32_t>();
+    return std::string(take(size), size);
+}
+
+Entity::ID SnapshotReader::readEntity()
+{
+    auto id = Entity::ID::fromValue(read<std::uint32_t>());
+    if (id.isNull() || !_relocations) return Entity::ID();
+
+    auto iter = _relocations->find(id.getValue());
+    return iter == _relocations->end() ? Entity::ID() : iter->second;
+}
+
+const char *SnapshotReader::take(std::size_t size)
+{
+    if (size > static_cast<std::size_t>(_end - _pos))
+    {
+        throw Exceptions::BadSnapshot(_path, "unexpected end of file");
+    }
+
+    auto data = _pos;
+    _pos += size;
+    return data;
+}
+
+SnapshotWriter Snapshot::capture(EntityManager &manager, std::uint64_t chain)
+{
+    std::vector<Selection> selections;
+    for (auto &pair : manager._archetypes)
+    {
+        auto archetype = pair.second.get();
+        if (!archetype->getSize()) continue;
+
+        Selection selection;
+        selection.archetype = archetype;
+        selection.rows.resize(archetype->getSize());
+        for (unsigned row = 0; row < selection.rows.size(); row++)
+        {
+            selection.rows[row] = row;
+        }
+        selections.push_back(std::move(selection));
+    }
+
+    return write(manager, Info{ false, chain, 0 }, selections,
+                 std::vector<Entity::ID>());
+}
+
+SnapshotWriter Snapshot::captureChanges(EntityManager &manager,
+                                        std::uint64_t chain,
+                                        std::uint32_t sequence)
+{
+    auto changes = manager.takeChanges();
+
+    // Group the changed entities' rows by archetype
+    std::vector<const EntityManager::EntityRecord *> records;
+    records.reserve(changes.changed.size());
+    for (auto id : changes.changed)
+    {
+        records.push_back(manager.findRecord(id));
+    }
+    std::sort(records.begin(), records.end(),
+              [](const EntityManager::EntityRecord *a,
+                 const EntityManager::EntityRecord *b)
+              {
+                  return a->archetype != b->archetype ?
+                      a->archetype < b->archetype : a->row < b->row;
+              });
+
+    std::vector<Selection> selections;
+    for (auto record : records)
+    {
+        if (selections.empty() ||
+            selections.back().archetype != record->archetype)
+        {
+            selections.push_back(Selection{ record->archetype, {} });
+        }
+        selections.back().rows.push_back(record->row);
+    }
+
+    return write(manager, Info{ true, chain, sequence }, selections,
+                 changes.destroyed);
+}
+
+void Snapshot::save(EntityManager &manager, const std::string &path)
+{
+    auto out = capture(manager);
+    out.writeFile(path);
+
+    LOG_INFO << "saved " << manager._entityCount << " entities to \""
+             << path << "\" (" << out.getSize() << " bytes)";
+}
+
+Snapshot::Info Snapshot::inspect(const std::string &path)
+{
+    // Only the header's needed, so don't bother mapping the whole file
+    std::ifstream file(path, std::ios::binary);
+    char header[64];
+    file.read(header, sizeof(header));
+
+    SnapshotReader in(header, static_cast<std::size_t>(file.gcount()), path);
+    return readHeader(in, path);
+}
+
+std::vector<Entity::ID> Snapshot::load(EntityManager &manager,
+                                       const std::string &path,
+                                       const std::string &debugName)
+{
+    Relocations relocations;
+    return load(manager, path, relocations, debugName);
+}
+
+std::vector<Entity::ID> Snapshot::load(EntityManager &manager,
+                                       const std::string &path,
+                                       Relocations &relocations,
+                                       const std::string &debugName)
+{
+    namespace ipc = boost::interprocess;
+
+    ipc::file_mapping file;
+    ipc::mapped_region region;
+    try
+    {
+        file = ipc::file_mapping(path.c_str(), ipc::read_only);
+        region = ipc::mapped_region(file, ipc::read_only);
+    }
+    catch (const ipc::interprocess_exception &e)
+    {
+        throw Exceptions::BadSnapshot(path, e.what());
+    }
+
+    SnapshotReader in(static_cast<const char *>(region.get_address()),
+                      region.get_size(), path);
+    readHeader(in, path);
+
+    auto typeCount = in.read<std::uint32_t>();
+    auto archetypeCount = in.read<std::uint32_t>();
+    auto entityCount = in.read<std::uint64_t>();
+    auto destroyedCount = in.read<std::uint64_t>();
+
+    // Deltas list what's been destroyed first, but nothing's applied until
+    // the whole file has been checked over
+    if (destroyedCount > region.get_size())
+    {
+        throw Exceptions::BadSnapshot(path, "unexpected end of file");
+    }
+    auto destroyedIds = in.take(destroyedCount * sizeof(std::uint32_t));
+
+    // Match saved types up with registered ones by name, since type IDs
+    // depend on the order types were first used in
+    auto &types = getTypes();
+    std::vector<unsigned> fileTypes;
+    fileTypes.reserve(typeCount);
+    for (std::uint32_t i = 0; i < typeCount; i++)
+    {
+        auto name = in.readString();
+        auto typeVersion = in.read<std::uint32_t>();
+
+        unsigned type = 0;
+        while (type < types.size() &&
+               (!types[type].load ||
+                TypeIds<Components::Component>::getName(type) != name))
+        {
+            type++;
+        }
+        if (type == types.size())
+        {
+            throw Exceptions::BadSnapshot(path, "component type " + name +
+                                                " isn't registered");
+        }
+        if (typeVersion != types[type].version)
+        {
+            std::ostringstream ss;
+            ss << "component type " << name << " was saved at version "
+               << typeVersion << ", expected " << types[type].version;
+            throw Exceptions::BadSnapshot(path, ss.str());
+        }
+        fileTypes.push_back(type);
+    }
+
+    // First pass works out which entity each saved one becomes, handing out
+    // all the new IDs at once, so components can refer to entities anywhere
+    // in the file
+    struct Block
+    {
+        std::vector<unsigned> types;
+        Archetype::Signature signature;
+        std::size_t rows;
+        std::size_t first;
+        std::size_t dataOffset;
+    };
+    std::vector<Block> blocks(archetypeCount);
+
+    if (entityCount > EntityID::MAX_INDEX + 1)
+    {
+        throw Exceptions::TooManyEntities();
+    }
+    std::vector<std::uint32_t> savedIds;
+    std::vector<Entity::ID> ids;
+    savedIds.reserve(static_cast<std::size_t>(entityCount));
+    ids.reserve(static_cast<std::size_t>(entityCount));
+
+    std::size_t newCount = 0;
+    for (auto &block : blocks)
+    {
+        auto columnCount = in.read<std::uint32_t>();
+        for (std::uint32_t i = 0; i < columnCount; i++)
+        {
+            auto index = in.read<std::uint32_t>();
+            if (index >= fileTypes.size())
+            {
+                throw Exceptions::BadSnapshot(path, "bad component type index");
+            }
+            block.types.push_back(fileTypes[index]);
+        }
+
+        block.signature = block.types;
+        std::sort(block.signature.begin(), block.signature.end());
+        if (std::adjacent_find(block.signature.begin(),
+                               block.signature.end()) != block.signature.end())
+        {
+            throw Exceptions::BadSnapshot(path, "component type repeated in archetype");
+        }
+
+        block.rows = static_cast<std::size_t>(in.read<std::uint64_t>());
+        if (block.rows > entityCount - savedIds.size())
+        {
+            throw Exceptions::BadSnapshot(path, "more entities than the header says");
+        }
+
+        block.first = savedIds.size();
+        auto data = in.take(block.rows * sizeof(std::uint32_t));
+        for (std::size_t row = 0; row < block.rows; row++)
+        {
+            std::uint32_t value;
+            std::memcpy(&value, data + row * sizeof(value), sizeof(value));
+            savedIds.push_back(value);
+
+            auto iter = relocations.find(value);
+            if (iter != relocations.end() && manager.isAlive(iter->second))
+            {
+                ids.push_back(iter->second);
+            }
+            else
+            {
+                ids.push_back(Entity::ID());
+                newCount++;
+            }
+        }
+
+        block.dataOffset = in.getOffset();
+        for (std::uint32_t i = 0; i < columnCount; i++)
+        {
+            in.take(static_cast<std::size_t>(in.read<std::uint64_t>()));
+        }
+    }
+    if (savedIds.size() != entityCount)
+    {
+        throw Exceptions::BadSnapshot(path, "fewer entities than the header says");
+    }
+    auto uuidsOffset = in.getOffset();
+
+    // The file checks out. Work out what it destroys, but leave destroying
+    // it until every component has loaded
+    std::vector<Entity::ID> destroyed;
+    std::vector<std::pair<std::uint32_t, Entity::ID>> forgotten;
+    for (std::uint64_t i = 0; i < destroyedCount; i++)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, destroyedIds + i * sizeof(value), sizeof(value));
+
+        auto iter = relocations.find(value);
+        if (iter != relocations.end())
+        {
+            if (manager.isAlive(iter->second)) destroyed.push_back(iter->second);
+            forgotten.push_back(*iter);
+            relocations.erase(iter);
+        }
+    }
+
+    auto newIds = manager.reserveEntities(newCount);
+    std::vector<std::uint32_t> newSavedIds;
+    newSavedIds.reserve(newCount);
+    for (std::size_t i = 0, next = 0; i < ids.size(); i++)
+    {
+        if (ids[i]) continue;
+
+        ids[i] = newIds[next++];
+        relocations[savedIds[i]] = ids[i];
+        newSavedIds.push_back(savedIds[i]);
+    }
+
+    // Second pass builds every component before any live row is touched,
+    // so a loader that throws leaves the manager and relocations as they
+    // were. They're kept by block, then column in saved order, then row
+    in._relocations = &relocations;
+    std::vector<std::vector<Components::Component *>> loaded;
+    try
+    {
+        for (auto &block : blocks)
+        {
+            in._pos = in._begin + block.dataOffset;
+            for (auto type : block.types)
+            {
+                auto load = types[type].load;
+                auto size = in.read<std::uint64_t>();
+
+                loaded.emplace_back();
+                loaded.back().reserve(block.rows);
+
+                auto start = in.getOffset();
+                for (std::size_t row = 0; row < block.rows; row++)
+                {
+                    loaded.back().push_back(load(ids[block.first + row], in));
+                }
+                if (in.getOffset() - start != size)
+                {
+                    throw Exceptions::BadSnapshot(
+                        path, "data for component type " +
+                              TypeIds<Components::Component>::getName(type) +
+                              " doesn't match what was saved");
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        for (auto &column : loaded)
+        {
+            for (auto component : column) delete component;
+        }
+
+        for (auto value : newSavedIds)
+        {
+            relocations.erase(value);
+        }
+        relocations.insert(forgotten.begin(), forgotten.end());
+
+        {
+            std::lock_guard<std::mutex> lock(manager._freeMutex);
+            manager._freeIds.insert(manager._freeIds.begin(),
+                                    newIds.begin(), newIds.end());
+        }
+        throw;
+    }
+
+    if (!destroyed.empty()) manager.destroyEntities(destroyed);
+
+    // Then each archetype's rows are filled in directly. Entities that are
+    // being replaced lose all their components first
+    manager._records.reserve(manager._nextIndex);
+    DebugName name(debugName);
+    auto columns = loaded.begin();
+    for (auto &block : blocks)
+    {
+        auto archetype = manager.getArchetype(block.signature);
+        archetype->reserve(archetype->getSize() + block.rows);
+
+        for (std::size_t row = 0; row < block.rows; row++)
+        {
+            auto id = ids[block.first + row];
+            auto record = manager.findRecord(id);
+            if (!record)
+            {
+                manager.insertEntity(id, name, archetype);
+                continue;
+            }
+
+            auto from = record->archetype;
+            for (unsigned column = 0; column < from->getSignature().size(); column++)
+            {
+                delete from->getComponent(record->row, column);
+                from->getComponent(record->row, column) = nullptr;
+            }
+            if (from != archetype) manager.moveEntity(*record, archetype);
+        }
+
+        // Rows can shift as entities are moved in and out, so look each
+        // one up again
+        for (auto type : block.types)
+        {
+            auto column = archetype->getColumn(type);
+            auto &components = *columns++;
+            for (std::size_t row = 0; row < block.rows; row++)
+            {
+                auto entityRow = manager.findRecord(ids[block.first + row])->row;
+                archetype->getComponent(entityRow, column) = components[row];
+                archetype->setVersion(entityRow, column, manager._version);
+            }
+        }
+    }
+
+    in._pos = in._begin + uuidsOffset;
+    auto uuidCount = in.read<std::uint64_t>();
+    for (std::uint64_t i = 0; i < uuidCount; i++)
+    {
+        auto id = in.readEntity();
+        auto uuid = in.read<uuid::uuid>();
+        if (id) manager.setUUID(id, uuid);
+    }
+
+    LOG_INFO << "loaded " << ids.size() << " entities from \"" << path
+             << "\" (" << newIds.size() << " new, " << destroyed.size()
+             << " destroyed)";
+
+    if (!newIds.empty())
+    {
+        Events::Dispatcher::raise<Events::EntitiesCreated>(std::move(newIds));
+    }
+
+    return ids;
+}
+
+std::vector<Snapshot::TypeInfo> &Snapshot::getTypes()
+{
+    static std::vector<TypeInfo> types;
+    return types;
+}
+
+void Snapshot::addType(unsigned type, const TypeInfo &info)
+{
+    auto &types = getTypes();
+    if (type >= types.size()) types.resize(type + 1, TypeInfo{0, nullptr, nullptr});
+    types[type] = info;
+}
+
+SnapshotWriter Snapshot::write(EntityManager &manager, const Info &info,
+                               const std::vector<Selection> &selections,
+                               const std::vector<Entity::ID> &destroyed)
+{
+    auto &types = getTypes();
+
+    SnapshotWriter out;
+    out.writeBytes(MAGIC, sizeof(MAGIC));
+    out.write(VERSION);
+    out.write(info.isDelta ? DELTA : FULL);
+    out.write(info.sequence);
+    out.write(info.chain);
+    auto typeCountAt = out.getSize();
+    out.write(std::uint32_t(0));
+    out.write(static_cast<std::uint32_t>(selections.size()));
+
+    std::uint64_t entityCount = 0;
+    for (auto &selection : selections)
+    {
+        entityCount += selection.rows.size();
+    }
+    out.write(entityCount);
+
+    out.write(static_cast<std::uint64_t>(destroyed.size()));
+    for (auto id : destroyed)
+    {
+        out.writeEntity(id);
+    }
+
+    // Type table, numbering each saved type in the order it's first seen
+    std::vector<std::uint32_t> typeIndices(
+        TypeIds<Components::Component>::getCount(), NOT_SEEN);
+    std::uint32_t typeCount = 0;
+    for (auto &selection : selections)
+    {
+        for (auto type : selection.archetype->getSignature())
+        {
+            if (typeIndices[type] != NOT_SEEN) continue;
+
+            if (type < types.size() && types[type].save)
+            {
+                out.write(TypeIds<Components::Component>::getName(type));
+                out.write(types[type].version);
+                typeIndices[type] = typeCount++;
+            }
+            else
+            {
+                LOG_WARNING << "leaving components of type "
+                            << TypeIds<Components::Component>::getName(type)
+                            << " out of snapshot, it has no SnapshotTraits";
+                typeIndices[type] = SKIPPED;
+            }
+        }
+    }
+    out.writeAt(typeCountAt, typeCount);
+
+    std::vector<Entity::ID> withUUIDs;
+    for (auto &selection : selections)
+    {
+        auto archetype = selection.archetype;
+        auto &signature = archetype->getSignature();
+        std::vector<unsigned> columns;
+        for (unsigned column = 0; column < signature.size(); column++)
+        {
+            if (typeIndices[signature[column]] != SKIPPED)
+            {
+                columns.push_back(column);
+            }
+        }
+
+        out.write(static_cast<std::uint32_t>(columns.size()));
+        for (auto column : columns)
+        {
+            out.write(typeIndices[signature[column]]);
+        }
+
+        out.write(static_cast<std::uint64_t>(selection.rows.size()));
+        for (auto row : selection.rows)
+        {
+            auto id = archetype->getEntity(row);
+            out.writeEntity(id);
+            if (manager._uuids.count(id)) withUUIDs.push_back(id);
+        }
+
+        // Then each type's data as one block, prefixed with its size so
+        // loading can skip over it
+        for (auto column : columns)
+        {
+            auto save = types[signature[column]].save;
+            auto sizeAt = out.getSize();
+            out.write(std::uint64_t(0));
+
+            auto start = out.getSize();
+            for (auto row : selection.rows)
+            {
+                save(*archetype->getComponent(row, column), out);
+            }
+            out.writeAt(sizeAt, static_cast<std::uint64_t>(out.getSize() - start));
+        }
+    }
+
+    out.write(static_cast<std::uint64_t>(withUUIDs.size()));
+    for (auto id : withUUIDs)
+    {
+        out.writeEntity(id);
+        out.write(manager._uuids.at(id));
+    }
+
+    return out;
+}
+
+Snapshot::Info Snapshot::readHeader(SnapshotReader &in, const std::string &path)
+{
+    if (std::memcmp(in.take(sizeof(MAGIC)), MAGIC, sizeof(MAGIC)))
+    {
+        throw Exceptions::BadSnapshot(path, "not a snapshot");
+    }
+
+    auto version = in.read<std::uint32_t>();
+    if (version != VERSION)
+    {
+        std::ostringstream ss;
+        ss << "format version " << version << ", expected " << VERSION;
+        throw Exceptions::BadSnapshot(path, ss.str());
+    }
+
+    Info info;
+    info.isDelta = in.read<std::uint32_t>() == DELTA;
+    info.sequence = in.read<std::uint32_t>();
+    info.chain = in.read<std::uint64_t>();
+    return info;
+}
@@ -0,0 +1,109 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "typeids.h"
+
+#include <boost/core/demangle.hpp>
+#include <cassert>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    // Maps are keyed on views of mangled type names. The names type_info
+    // hands out only live as long as the module they came from, so the
+    // views point at the registry's own copies instead. Looking a type up
+    // doesn't allocate
+    template <class V>
+    using NameMap = std::unordered_map<std::string_view, V>;
+
+    struct Family
+    {
+        NameMap<unsigned> ids;
+        std::vector<std::string> names;
+    };
+
+    // Constructed on first use, since IDs may be requested during static
+    // initialisation
+    struct Registry
+    {
+        std::mutex mutex;
+        NameMap<Family> families;
+
+        // Every key above. A deque never moves its elements, so views into
+        // them stay valid as it grows
+        std::deque<std::string> keys;
+
+        std::string_view copyKey(const char *name)
+        {
+            keys.emplace_back(name);
+            return keys.back();
+        }
+    };
+
+    Registry &getRegistry()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    Family &getFamily(Registry &registry, const std::type_info &family)
+    {
+        auto i = registry.families.find(family.name());
+        if (i != registry.families.end()) return i->second;
+
+        return registry.families[registry.copyKey(family.name())];
+    }
+}
+
+unsigned detail::getTypeId(const std::type_info &family,
+                           const std::type_info &type)
+{
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto &f = getFamily(registry, family);
+    auto i = f.ids.find(type.name());
+    if (i != f.ids.end()) return i->second;
+
+    auto id = static_cast<unsigned>(f.names.size());
+    f.ids.emplace(registry.copyKey(type.name()), id);
+    f.names.push_back(boost::core::demangle(type.name()));
+    return id;
+}
+
+unsigned detail::getTypeIdCount(const std::type_info &family)
+{
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto i = registry.families.find(family.name());
+    return i == registry.families.end() ?
+        0 : static_cast<unsigned>(i->second.names.size());
+}
+
+std::string detail::getTypeIdName(const std::type_info &family, unsigned id)
+{
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    auto &f = getFamily(registry, family);
+    assert(id < f.names.size());
+    return f.names[id];
+}
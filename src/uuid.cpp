@@ -18,20 +18,21 @@
 #include "uuid.h"
 
 #ifdef _USE_CUSTOM_UUID
-#   include <cstdlib>
+#   include <cstdint>
 #   include <ctime>
 #else
 #   include <boost/uuid/random_generator.hpp>
 #endif
 
+// Per thread, so systems can make UUIDs while running in parallel
 namespace
 {
-    bool _initialized = false;
+    thread_local bool _initialized = false;
 
 #ifdef _USE_CUSTOM_UUID
-    uuid::uuid _state[2];
+    thread_local uuid::uuid _state[2];
 #else
-    boost::uuids::random_generator _generator;
+    thread_local boost::uuids::random_generator _generator;
 #endif
 }
 
@@ -40,9 +41,18 @@ void uuid::initialize()
 #ifdef _USE_CUSTOM_UUID
     using namespace std;
 
-    srand(time(nullptr));
-    _state[0] = rand();
-    _state[1] = rand();
+    // Mix in the address of this thread's state, so threads that start in
+    // the same second still get different streams. rand() isn't
+    // thread-safe, so spread the seed with splitmix64 instead
+    uuid seed = static_cast<uuid>(time(nullptr)) ^
+                reinterpret_cast<uintptr_t>(&_state);
+    for (auto &state : _state)
+    {
+        uuid z = (seed += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        state = z ^ (z >> 31);
+    }
 #endif
 
     _initialized = true;
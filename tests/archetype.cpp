@@ -0,0 +1,238 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+
+#include "entitymanager.h"
+#include "test.h"
+
+using Test::Position;
+using Test::Velocity;
+
+namespace
+{
+    // Each component type comes out of a pool of its own, so one type's
+    // components are laid out back to back rather than interleaved with
+    // every other type of the same size
+    void testComponentPools()
+    {
+        EntityManager manager;
+
+        auto live = Position::getTypePoolStats().live;
+
+        std::vector<Entity::ID> ids;
+        std::vector<Position *> positions;
+        for (int i = 0; i < 10; i++)
+        {
+            auto id = manager.createEntity();
+            ids.push_back(id);
+            positions.push_back(Position::create(id, i, i));
+            Velocity::create(id);
+        }
+        CHECK(Position::getTypePoolStats().live == live + 10);
+
+        for (unsigned i = 1; i < positions.size(); i++)
+        {
+            auto gap = reinterpret_cast<char *>(positions[i]) -
+                       reinterpret_cast<char *>(positions[i - 1]);
+            CHECK(gap > 0 && gap <= static_cast<long>(2 * sizeof(Position)));
+        }
+
+        manager.destroyEntities(ids);
+        CHECK(Position::getTypePoolStats().live == live);
+    }
+
+    void testComponentHandles()
+    {
+        EntityManager manager;
+
+        auto a = manager.createEntity();
+        auto position = Position::create(a, 3, 4);
+        auto handle = manager.getHandle<Position>(a);
+        CHECK(handle == position->getHandle());
+        CHECK(Position::resolve(handle) == position);
+        CHECK(!Position::resolve(Handle<Position>()));
+
+        // The slot gets reused by the next Position, but the old handle
+        // doesn't follow it there
+        delete manager.removeComponent<Position>(a);
+        CHECK(!Position::resolve(handle));
+
+        auto b = manager.createEntity();
+        auto reused = Position::create(b);
+        CHECK(reused == position);
+        CHECK(!Position::resolve(handle));
+        CHECK(Position::resolve(manager.getHandle<Position>(b)) == reused);
+    }
+
+    // Entities move between archetypes as components come and go, and
+    // views, queries and each() all see the same thing
+    void testViews()
+    {
+        EntityManager manager;
+        auto &query = manager.query<Position, Velocity>();
+
+        std::vector<Entity::ID> ids;
+        for (int i = 0; i < 1000; i++)
+        {
+            auto id = manager.createEntity();
+            Position::create(id, i, 0);
+            if (i % 4 == 0) Velocity::create(id, 1, 0);
+            ids.push_back(id);
+        }
+
+        CHECK(manager.view<Position>().size() == 1000);
+        CHECK((manager.view<Position, Velocity>().size() == 250));
+        CHECK(query.size() == 250);
+
+        int count = 0;
+        float sum = 0;
+        manager.each<Velocity, Position>(
+            [&](Entity::ID id, Velocity &v, Position &p)
+            {
+                CHECK((manager.getComponent<Position>(id) == &p));
+                count++;
+                sum += p.x * v.dx;
+            });
+        CHECK(count == 250);
+        CHECK(sum == 124500);
+
+        // Taking every other Velocity away moves those entities back, and
+        // the rows left behind are filled from the end
+        for (int i = 0; i < 1000; i += 8)
+        {
+            delete manager.removeComponent<Velocity>(ids[i]);
+        }
+        CHECK(query.size() == 125);
+        count = 0;
+        query.each([&count](Entity::ID, Position &p, Velocity &)
+                   { if (static_cast<int>(p.x) % 8 == 4) count++; });
+        CHECK(count == 125);
+        for (auto id : ids)
+        {
+            CHECK(manager.getComponent<Position>(id)->getParent() == id);
+        }
+
+        // A view built while a matching archetype is empty still sees the
+        // entities that move into it later
+        for (auto id : ids)
+        {
+            if (manager.tryGetComponent<Velocity>(id))
+            {
+                delete manager.removeComponent<Velocity>(id);
+            }
+        }
+        auto view = manager.view<Position, Velocity>();
+        CHECK(view.empty());
+        Velocity::create(ids[0], 1, 0);
+        CHECK(view.size() == 1);
+    }
+
+    // eachChanged() visits what's been added or marked changed at or after
+    // the given version, and nothing else
+    void testEachChanged()
+    {
+        EntityManager manager;
+
+        std::vector<Entity::ID> ids;
+        for (int i = 0; i < 1000; i++)
+        {
+            auto id = manager.createEntity();
+            Position::create(id);
+            ids.push_back(id);
+        }
+
+        auto count = [&manager](Archetype::Version since)
+        {
+            int visited = 0;
+            manager.eachChanged<Position>(since,
+                [&visited](Entity::ID, Position &) { visited++; });
+            return visited;
+        };
+
+        auto start = manager.getVersion();
+        CHECK(count(start) == 1000);
+
+        manager.playback();
+        auto since = manager.getVersion();
+        CHECK(count(since) == 0);
+
+        manager.markChanged<Position>(ids[3]);
+        manager.markChanged<Position>(ids[999]);
+        CHECK(count(since) == 2);
+        CHECK(count(start) == 1000);
+
+        int visited = 0;
+        manager.query<Position>().eachChanged(since,
+            [&](Entity::ID id, Position &)
+            {
+                CHECK(id == ids[3] || id == ids[999]);
+                visited++;
+            });
+        CHECK(visited == 2);
+
+        manager.playback();
+        CHECK(count(manager.getVersion()) == 0);
+    }
+
+    void testChunks()
+    {
+        Archetype archetype(Archetype::Signature{});
+        auto perChunk = archetype.getChunkCapacity();
+        Entity::ID moved;
+
+        // Going back and forth across a chunk boundary keeps the spare
+        for (unsigned i = 0; i < perChunk; i++) archetype.addRow(Entity::ID(i, 0), 1);
+        CHECK(archetype.getCapacity() == perChunk);
+        archetype.addRow(Entity::ID(perChunk, 0), 1);
+        CHECK(archetype.getCapacity() == 2 * perChunk);
+        archetype.removeRow(perChunk, moved);
+        CHECK(archetype.getCapacity() == 2 * perChunk);
+
+        // Emptying out releases everything but the spare
+        for (unsigned i = perChunk; i-- > 0; ) archetype.removeRow(i, moved);
+        CHECK(archetype.getSize() == 0);
+        CHECK(archetype.getCapacity() == perChunk);
+
+        // Reserved chunks stay put until shrink()
+        archetype.reserve(4 * perChunk);
+        archetype.addRow(Entity::ID(0, 0), 1);
+        archetype.removeRow(0, moved);
+        CHECK(archetype.getCapacity() == 4 * perChunk);
+        archetype.shrink();
+        CHECK(archetype.getCapacity() == 0);
+
+        // Rows move down into holes, and say which entity moved
+        for (unsigned i = 0; i < 3; i++) archetype.addRow(Entity::ID(i, 0), 1);
+        CHECK(archetype.removeRow(0, moved) && moved == Entity::ID(2, 0));
+        CHECK(archetype.getEntity(0) == Entity::ID(2, 0));
+        CHECK(!archetype.removeRow(1, moved));
+    }
+}
+
+int main()
+{
+    Test::init();
+
+    testComponentPools();
+    testComponentHandles();
+    testViews();
+    testEachChanged();
+    testChunks();
+
+    return Test::finish();
+}
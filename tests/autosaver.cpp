@@ -0,0 +1,147 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/filesystem.hpp>
+
+#include "autosaver.h"
+#include "entitymanager.h"
+#include "test.h"
+
+using Test::Position;
+using Test::Resource;
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+    void testChain(const fs::path &directory)
+    {
+        auto path = (directory / "save.bin").string();
+        {
+            EntityManager manager;
+            Autosaver saver(manager, path);
+
+            auto a = manager.createEntity();
+            Position::create(a, 1, 1);
+            saver.save();
+            saver.flush();
+
+            auto b = manager.createEntity();
+            Position::create(b, 2, 2);
+            saver.save();
+            saver.flush();
+
+            auto base = Snapshot::inspect(path);
+            CHECK(!base.isDelta);
+            auto delta = Snapshot::inspect(path + ".1");
+            CHECK(delta.isDelta && delta.chain == base.chain &&
+                  delta.sequence == 1);
+        }
+
+        EntityManager manager;
+        Autosaver::load(manager, path);
+        CHECK(manager.view<Position>().size() == 2);
+    }
+
+    // Once a delta's been lost the ones after it can't be loaded, so the
+    // next save starts over with a full snapshot
+    void testFailedWrite(const fs::path &directory)
+    {
+        auto path = (directory / "save.bin").string();
+        {
+            EntityManager manager;
+            Autosaver saver(manager, path);
+
+            Position::create(manager.createEntity());
+            saver.save();
+            saver.flush();
+            auto base = Snapshot::inspect(path);
+
+            fs::remove_all(directory);
+            Position::create(manager.createEntity());
+            saver.save();
+            saver.flush();
+            fs::create_directories(directory);
+
+            Position::create(manager.createEntity());
+            saver.save();
+            saver.flush();
+            auto rebased = Snapshot::inspect(path);
+            CHECK(!rebased.isDelta);
+            CHECK(rebased.chain != base.chain);
+
+            Position::create(manager.createEntity());
+            saver.save();
+            saver.flush();
+            CHECK(Snapshot::inspect(path + ".1").chain == rebased.chain);
+        }
+
+        EntityManager manager;
+        Autosaver::load(manager, path);
+        CHECK(manager.view<Position>().size() == 4);
+    }
+
+    // A delta replaces every changed entity's components, so the entity's
+    // old ones are still alive while its new ones load
+    void testReplacedComponent(const fs::path &directory)
+    {
+        auto path = (directory / "save.bin").string();
+        {
+            EntityManager manager;
+            Autosaver saver(manager, path);
+
+            auto id = manager.createEntity();
+            Resource::create(id, 1);
+            Position::create(manager.createEntity());
+            saver.save();
+            saver.flush();
+
+            manager.getComponent<Resource>(id)->value = 2;
+            manager.markChanged<Resource>(id);
+            saver.save();
+            saver.flush();
+            CHECK(Snapshot::inspect(path + ".1").isDelta);
+        }
+        CHECK(Resource::getClaimed().empty());
+
+        EntityManager manager;
+        Autosaver::load(manager, path);
+        CHECK(Resource::getClaimed().size() == 1);
+        CHECK(manager.view<Position>().size() == 1);
+
+        float value = 0;
+        manager.each<Resource>([&value](Entity::ID, Resource &r) { value = r.value; });
+        CHECK(value == 2);
+    }
+}
+
+int main()
+{
+    Test::init();
+
+    Snapshot::registerType<Position>();
+    Snapshot::registerType<Resource>();
+
+    auto directory = fs::temp_directory_path() /
+                     fs::unique_path("autosaver-%%%%-%%%%");
+    testChain(directory / "chain");
+    testFailedWrite(directory / "failed");
+    testReplacedComponent(directory / "replaced");
+    fs::remove_all(directory);
+
+    return Test::finish();
+}
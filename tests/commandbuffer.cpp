@@ -0,0 +1,94 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "commandbuffer.h"
+#include "entitymanager.h"
+#include "test.h"
+
+using Test::Position;
+using Test::Velocity;
+
+namespace
+{
+    void testPlayback()
+    {
+        EntityManager manager;
+        auto &buffer = manager.getCommandBuffer();
+
+        auto a = buffer.createEntity("a");
+        buffer.addComponent<Position>(a, 1.0f, 2.0f);
+        buffer.addComponent<Velocity>(a);
+        CHECK(!manager.isAlive(a));
+
+        auto version = manager.getVersion();
+        manager.playback();
+        CHECK(buffer.empty());
+        CHECK(manager.getVersion() == version + 1);
+        CHECK(manager.getComponent<Position>(a)->y == 2);
+
+        buffer.removeComponent<Velocity>(a);
+        buffer.markChanged<Position>(a);
+        manager.playback();
+        CHECK(!manager.tryGetComponent<Velocity>(a));
+
+        int changed = 0;
+        manager.eachChanged<Position>(version + 1,
+            [&changed](Entity::ID, Position &) { changed++; });
+        CHECK(changed == 1);
+
+        buffer.destroyEntity(a);
+        buffer.destroyEntity(a);
+        manager.playback();
+        CHECK(!manager.isAlive(a));
+    }
+
+    // An add that clashes with what's already there is dropped without
+    // taking the rest of the batch down with it, or leaking the component
+    void testConflictingAdd()
+    {
+        EntityManager manager;
+        auto a = manager.createEntity();
+        auto b = manager.createEntity();
+        auto dead = manager.createEntity();
+        Position::create(a, 1, 1);
+        manager.destroyEntity(dead);
+
+        auto live = Position::getTypePoolStats().live;
+
+        auto &buffer = manager.getCommandBuffer();
+        buffer.addComponent<Position>(a, 5.0f, 5.0f);
+        buffer.addComponent<Position>(dead);
+        buffer.addComponent<Position>(b, 2.0f, 2.0f);
+        buffer.addComponent<Position>(b, 3.0f, 3.0f);
+        buffer.destroyEntity(a);
+        manager.playback();
+
+        CHECK(!manager.isAlive(a));
+        CHECK(manager.getComponent<Position>(b)->x == 2);
+        CHECK(Position::getTypePoolStats().live == live);
+    }
+}
+
+int main()
+{
+    Test::init();
+
+    testPlayback();
+    testConflictingAdd();
+
+    return Test::finish();
+}
@@ -0,0 +1,70 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "entitymanager.h"
+#include "test.h"
+
+using Test::Position;
+
+namespace
+{
+    void testInterning()
+    {
+        DebugName a("player"), b(std::string("player")), c("enemy");
+#ifdef _DEBUG_NAMES
+        CHECK(a == b);
+        CHECK(a != c);
+        CHECK(a.str() == "player");
+        CHECK(DebugName().empty());
+#else
+        CHECK(a.str().empty() && c.str().empty());
+#endif
+    }
+
+    void testComponentNames()
+    {
+        EntityManager manager;
+        EntityManager::setCurrent(&manager);
+
+        auto id = manager.createEntity("player");
+        auto position = Position::create(id);
+        auto named = new Position(id);
+
+#ifdef _DEBUG_NAMES
+        CHECK(Position::getTypeDebugName().str() == "Position");
+        CHECK(manager.getDebugName(id) == "player");
+        CHECK(position->getDebugName() == "playerPosition");
+#else
+        CHECK(Position::getTypeDebugName().empty());
+        CHECK(manager.getDebugName(id).empty());
+        CHECK(position->getDebugName().empty());
+#endif
+
+        delete named;
+        EntityManager::setCurrent(nullptr);
+    }
+}
+
+int main()
+{
+    Test::init();
+
+    testInterning();
+    testComponentNames();
+
+    return Test::finish();
+}
@@ -0,0 +1,144 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "entitymanager.h"
+#include "test.h"
+
+using Test::Position;
+
+namespace
+{
+    struct DestroyListener : public Events::Subscriber, public Stringable
+    {
+        std::vector<Entity::ID> destroyed;
+
+        DestroyListener()
+        {
+            Events::Dispatcher::subscribe<Events::EntitiesDestroyed>(*this);
+        }
+
+        ~DestroyListener()
+        {
+            Events::Dispatcher::unsubscribe(*this);
+        }
+
+        void onEvent(const Events::EntitiesDestroyed &event)
+        {
+            destroyed.insert(destroyed.end(), event.ids.begin(), event.ids.end());
+        }
+
+        std::string toString() const override { return "DestroyListener"; }
+    };
+
+    void testStaleIds()
+    {
+        EntityManager manager;
+
+        auto a = manager.createEntity("a");
+        auto b = manager.createEntity("b");
+        CHECK(a != b);
+        CHECK(manager.isAlive(a) && manager.isAlive(b));
+
+        manager.destroyEntity(a);
+        CHECK(!manager.isAlive(a));
+        CHECK_THROWS(manager.destroyEntity(a), Exceptions::NoSuchEntity);
+
+        // Freed slots are handed out again, but on a later generation
+        std::vector<Entity::ID> created;
+        for (int i = 0; i < 100; i++) created.push_back(manager.createEntity());
+        for (auto id : created)
+        {
+            CHECK(id != a);
+            if (id.getIndex() == a.getIndex())
+            {
+                CHECK(id.getGeneration() == a.getGeneration() + 1);
+            }
+        }
+        CHECK(!manager.isAlive(a));
+        CHECK(!manager.tryGetComponent<Position>(a));
+    }
+
+    // Asking for an entity twice destroys it once, and it's only reported
+    // once
+    void testBatchDestroy()
+    {
+        EntityManager manager;
+        DestroyListener listener;
+
+        auto ids = manager.createEntities(3);
+        Position::create(ids[1]);
+        manager.destroyEntities({ ids[0], ids[1], ids[0], ids[1] });
+
+        CHECK(!manager.isAlive(ids[0]) && !manager.isAlive(ids[1]));
+        CHECK(manager.isAlive(ids[2]));
+        CHECK(listener.destroyed.size() == 2);
+        CHECK(std::count(listener.destroyed.begin(), listener.destroyed.end(),
+                         ids[0]) == 1);
+        CHECK(std::count(listener.destroyed.begin(), listener.destroyed.end(),
+                         ids[1]) == 1);
+    }
+
+    void testUUIDs()
+    {
+        EntityManager manager;
+
+        auto a = manager.createEntity();
+        auto b = manager.createEntity();
+        CHECK(!manager.hasUUID(a));
+
+        auto uuid = manager.getUUID(a);
+        CHECK(manager.hasUUID(a));
+        CHECK(manager.getUUID(a) == uuid);
+        CHECK(manager.findEntity(uuid) == a);
+        CHECK(!manager.hasUUID(b));
+
+        manager.destroyEntity(a);
+        CHECK(manager.findEntity(uuid).isNull());
+    }
+
+    void testComponents()
+    {
+        EntityManager manager;
+
+        auto a = manager.createEntity();
+        Position::create(a, 1, 2);
+        CHECK(manager.getComponent<Position>(a)->x == 1);
+
+        auto removed = manager.removeComponent<Position>(a);
+        CHECK(removed && removed->y == 2);
+        delete removed;
+        CHECK(!manager.tryGetComponent<Position>(a));
+        CHECK_THROWS(manager.getComponent<Position>(a),
+                     Exceptions::NoSuchComponent);
+    }
+}
+
+int main()
+{
+    Test::init();
+
+    static_assert(sizeof(Entity::ID) == 4, "entity IDs should be 32 bits");
+
+    testStaleIds();
+    testBatchDestroy();
+    testUUIDs();
+    testComponents();
+
+    return Test::finish();
+}
@@ -0,0 +1,90 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <vector>
+
+#include "jobsystem.h"
+#include "test.h"
+
+namespace
+{
+    // Every index covered exactly once, whatever order the pieces run in
+    void testParallelFor(JobSystem &jobs)
+    {
+        std::vector<int> hits(10000, 0);
+        jobs.parallelFor(0, hits.size(), 64,
+            [&hits](std::size_t first, std::size_t last)
+            {
+                for (auto i = first; i < last; i++) hits[i]++;
+            });
+
+        bool once = true;
+        for (auto hit : hits) once = once && hit == 1;
+        CHECK(once);
+    }
+
+    // Followers only run once everything they follow has, and a counter
+    // isn't done until its followers are queued
+    void testRunAfter(JobSystem &jobs)
+    {
+        for (int round = 0; round < 200; round++)
+        {
+            std::atomic<int> first(0), second(0), early(0);
+
+            JobCounter a, b;
+            for (int i = 0; i < 16; i++) jobs.run([&first] { first++; }, &a);
+            for (int i = 0; i < 4; i++)
+            {
+                jobs.runAfter(a, [&]
+                {
+                    if (first != 16) early++;
+                    second++;
+                }, &b);
+            }
+
+            JobCounter c;
+            jobs.runAfter(b, [&] { if (second != 4) early++; }, &c);
+            jobs.wait(c);
+            jobs.wait(b);
+            jobs.wait(a);
+
+            CHECK(first == 16 && second == 4 && early == 0);
+        }
+
+        // Nothing left to wait for, so it's queued straight away
+        JobCounter done, counter;
+        bool ran = false;
+        jobs.runAfter(done, [&ran] { ran = true; }, &counter);
+        jobs.wait(counter);
+        CHECK(ran);
+    }
+}
+
+int main()
+{
+    Test::init();
+
+    for (unsigned threads : { 1, 4 })
+    {
+        JobSystem jobs(threads);
+        testParallelFor(jobs);
+        testRunAfter(jobs);
+    }
+
+    return Test::finish();
+}
@@ -0,0 +1,210 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <boost/thread/thread.hpp>
+#include <vector>
+
+#include "concurrentpool.h"
+#include "pool.h"
+#include "poolregistry.h"
+#include "sizeclasspool.h"
+#include "test.h"
+
+namespace
+{
+    struct Particle
+    {
+        float x, y, z;
+        int life;
+
+        Particle(int life_ = 0) : x(0), y(0), z(0), life(life_) {}
+    };
+
+    struct alignas(32) Wide
+    {
+        float lanes[8];
+    };
+
+    bool isRegistered(const std::string &kind)
+    {
+        for (auto &entry : PoolRegistry::snapshot())
+        {
+            if (entry.kind == kind && entry.typeName.find("Particle") !=
+                                      std::string::npos)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void testPool()
+    {
+        Pool<Particle, 8> pool;
+        CHECK(isRegistered("Pool"));
+
+        std::vector<Particle *> objects;
+        for (int i = 0; i < 8; i++) objects.push_back(new (pool.allocate()) Particle(i));
+        CHECK_THROWS(pool.allocate(), Exceptions::PoolOutOfMemory);
+        CHECK(pool.getStats().live == 8);
+        CHECK(pool.getStats().failures == 1);
+
+        auto handle = pool.getHandle(objects[3]);
+        CHECK(pool.resolve(handle) == objects[3]);
+        pool.release(objects[3]);
+        CHECK(!pool.resolve(handle));
+
+        int live = 0;
+        pool.forEach([&live](Particle &) { live++; });
+        CHECK(live == 7);
+
+        for (auto object : objects)
+        {
+            if (object != objects[3]) pool.release(object);
+        }
+        CHECK(pool.getStats().live == 0);
+        CHECK(pool.getStats().peak == 8);
+    }
+
+    void testGrowablePool()
+    {
+        GrowablePool<Particle, 4> pool;
+
+        std::vector<Particle *> objects;
+        for (int i = 0; i < 100; i++) objects.push_back(new (pool.allocate()) Particle(i));
+        CHECK(pool.getCapacity() >= 100);
+        CHECK(pool.getSlabCount() > 1);
+
+        // Handles into later slabs resolve through the doubling layout
+        for (auto object : objects)
+        {
+            CHECK(pool.resolve(pool.getHandle(object)) == object);
+        }
+        for (auto object : objects) pool.release(object);
+        CHECK(pool.getStats().live == 0);
+    }
+
+    void testAlignment()
+    {
+        Pool<Wide, 16> pool;
+        GrowablePool<Particle, 4, 0, PoolOptions::CacheAligned> padded;
+        for (int i = 0; i < 16; i++)
+        {
+            auto wide = pool.allocate();
+            CHECK(reinterpret_cast<std::uintptr_t>(wide) % alignof(Wide) == 0);
+
+            auto particle = padded.allocate();
+            CHECK(reinterpret_cast<std::uintptr_t>(particle) %
+                  CACHE_LINE_SIZE == 0);
+        }
+    }
+
+    void testSizeClassPool()
+    {
+        SizeClassPool<8> pool;
+        for (std::size_t size : { 1, 32, 33, 200, 512, 513, 4096 })
+        {
+            auto p = pool.allocate(size);
+            CHECK(p);
+            CHECK(reinterpret_cast<std::uintptr_t>(p) %
+                  alignof(std::max_align_t) == 0);
+            pool.release(p, size);
+        }
+    }
+
+    void testConcurrentPool()
+    {
+        static ConcurrentPool<Particle, 4096> pool;
+
+        const int threads = 4;
+        std::atomic<int> failures(0);
+        std::vector<boost::thread> workers;
+        for (int t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&failures]
+            {
+                std::vector<Particle *> objects;
+                for (int round = 0; round < 100; round++)
+                {
+                    for (int i = 0; i < 256; i++)
+                    {
+                        objects.push_back(new (pool.allocate()) Particle(i));
+                    }
+                    for (int i = 0; i < 256; i++)
+                    {
+                        if (objects[i]->life != i) failures++;
+                        pool.release(objects[i]);
+                    }
+                    objects.clear();
+                }
+                pool.flushThreadCache();
+            });
+        }
+        for (auto &worker : workers) worker.join();
+
+        CHECK(failures == 0);
+        CHECK(pool.getStats().live == 0);
+        CHECK(pool.getStats().allocations == threads * 100 * 256);
+
+        // Running dry either throws or hands back nullptr
+        ConcurrentPool<Particle, 8> small;
+        std::vector<Particle *> objects;
+        while (auto particle = small.tryAllocate()) objects.push_back(particle);
+        CHECK(objects.size() == 8);
+        CHECK_THROWS(small.allocate(), Exceptions::PoolOutOfMemory);
+        CHECK(small.getStats().failures == 2);
+        for (auto particle : objects) small.release(particle);
+    }
+
+    // Pools come and go on one thread while another keeps asking the
+    // registry for their stats
+    void testRegistryRace()
+    {
+        std::atomic<bool> done(false);
+        boost::thread reader([&done]
+        {
+            while (!done) PoolRegistry::snapshot();
+        });
+
+        for (int i = 0; i < 2000; i++)
+        {
+            GrowablePool<Particle, 16> pool;
+            pool.release(pool.allocate());
+        }
+        done = true;
+        reader.join();
+
+        CHECK(!isRegistered("GrowablePool"));
+    }
+}
+
+int main()
+{
+    Test::init();
+
+    testPool();
+    testGrowablePool();
+    testAlignment();
+    testSizeClassPool();
+    testConcurrentPool();
+    testRegistryRace();
+
+    CHECK(!isRegistered("Pool"));
+
+    return Test::finish();
+}
@@ -0,0 +1,148 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/filesystem.hpp>
+
+#include "entitymanager.h"
+#include "snapshot.h"
+#include "test.h"
+
+using Test::Position;
+using Test::Resource;
+using Test::Velocity;
+
+namespace
+{
+    std::string getTempPath()
+    {
+        return (boost::filesystem::temp_directory_path() /
+                boost::filesystem::unique_path("snapshot-%%%%-%%%%.bin")).string();
+    }
+
+    void save(const std::string &path)
+    {
+        EntityManager manager;
+        for (int i = 0; i < 10; i++)
+        {
+            auto id = manager.createEntity();
+            Position::create(id, i, -i);
+            if (i % 2) Velocity::create(id, 1, 2);
+        }
+        Snapshot::save(manager, path);
+    }
+
+    void testRoundTrip(const std::string &path)
+    {
+        EntityManager manager;
+        auto ids = Snapshot::load(manager, path);
+        CHECK(ids.size() == 10);
+
+        float sum = 0;
+        manager.each<Position>([&sum](Entity::ID, Position &p) { sum += p.x - p.y; });
+        CHECK(sum == 90);
+
+        int moving = 0;
+        manager.each<Position, Velocity>(
+            [&moving](Entity::ID, Position &, Velocity &v)
+                { if (v.dx == 1 && v.dy == 2) moving++; });
+        CHECK(moving == 5);
+    }
+
+    // A loader that throws part way through leaves everything as it was,
+    // with no half-replaced entities or leaked components
+    void testFailedLoad(const std::string &path)
+    {
+        EntityManager manager;
+        Snapshot::Relocations relocations;
+        auto ids = Snapshot::load(manager, path, relocations);
+        auto before = relocations;
+
+        auto positions = Position::getTypePoolStats().live;
+        auto velocities = Velocity::getTypePoolStats().live;
+
+        SnapshotTraits<Velocity>::failLoads = true;
+        CHECK_THROWS(Snapshot::load(manager, path, relocations),
+                     Exceptions::BadSnapshot);
+        CHECK_THROWS(Snapshot::load(manager, path), Exceptions::BadSnapshot);
+        SnapshotTraits<Velocity>::failLoads = false;
+
+        CHECK(relocations == before);
+        CHECK(Position::getTypePoolStats().live == positions);
+        CHECK(Velocity::getTypePoolStats().live == velocities);
+        CHECK(manager.view<Position>().size() == 10);
+
+        int count = 0;
+        manager.each<Position>([&count](Entity::ID, Position &) { count++; });
+        CHECK(count == 10);
+        for (auto id : ids)
+        {
+            CHECK(manager.getComponent<Position>(id));
+        }
+
+        // The IDs it reserved are handed out again
+        auto next = manager.createEntity();
+        CHECK(next.getIndex() < 20);
+    }
+
+    // Loading over entities that already have a component builds the new
+    // one while the old is still alive, so whatever it claims by name has
+    // to be claimed under a different one
+    void testReplace(const std::string &path)
+    {
+        {
+            EntityManager manager;
+            for (int i = 0; i < 10; i++) Resource::create(manager.createEntity(), i);
+            Snapshot::save(manager, path);
+        }
+
+        EntityManager manager;
+        Snapshot::Relocations relocations;
+        auto ids = Snapshot::load(manager, path, relocations);
+        CHECK(Resource::getClaimed().size() == 10);
+        for (auto id : ids) manager.getComponent<Resource>(id)->value = -1;
+
+        auto replaced = Snapshot::load(manager, path, relocations);
+        CHECK(replaced == ids);
+        CHECK(Resource::getClaimed().size() == 10);
+
+        float sum = 0;
+        manager.each<Resource>([&sum](Entity::ID, Resource &r) { sum += r.value; });
+        CHECK(sum == 45);
+
+        // And alongside the ones already there
+        Snapshot::load(manager, path);
+        CHECK(Resource::getClaimed().size() == 20);
+    }
+}
+
+int main()
+{
+    Test::init();
+
+    Snapshot::registerType<Position>();
+    Snapshot::registerType<Velocity>();
+    Snapshot::registerType<Resource>();
+
+    auto path = getTempPath();
+    save(path);
+    testRoundTrip(path);
+    testFailedLoad(path);
+    testReplace(path);
+    boost::filesystem::remove(path);
+
+    return Test::finish();
+}
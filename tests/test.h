@@ -0,0 +1,212 @@
+/* game
+ * Copyright (C) 2014-2018 Scott Bishop <treewojima@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __OGRE_TESTS_TEST_H__
+#define __OGRE_TESTS_TEST_H__
+
+#include "defines.h"
+
+#include <boost/log/core.hpp>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "entity.h"
+#include "exceptions.h"
+#include "snapshot.h"
+
+// Bare-bones checks for the test programs. A failed check is reported and
+// counted, and the test carries on so one run shows every failure
+namespace Test
+{
+    inline int &getFailures()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    // Debug builds log every pool allocation, which drowns out the results
+    inline void init()
+    {
+        boost::log::core::get()->set_logging_enabled(false);
+    }
+
+    inline int finish()
+    {
+        if (getFailures())
+        {
+            std::cerr << getFailures() << " checks failed" << std::endl;
+        }
+        return getFailures() ? 1 : 0;
+    }
+
+    // Components to test with, created the way real ones are
+    struct Position : Components::Specific<Position>
+    {
+        float x, y;
+
+        Position(Entity::ID parent, float x_ = 0, float y_ = 0) :
+            Specific(parent), x(x_), y(y_) {}
+
+        static Position *create(Entity::ID parent, float x = 0, float y = 0)
+        {
+            auto ptr = new Position(parent, x, y);
+            Events::Dispatcher::raise<Events::ComponentCreated>(ptr);
+            return ptr;
+        }
+    };
+
+    struct Velocity : Components::Specific<Velocity>
+    {
+        float dx, dy;
+
+        Velocity(Entity::ID parent, float dx_ = 0, float dy_ = 0) :
+            Specific(parent), dx(dx_), dy(dy_) {}
+
+        static Velocity *create(Entity::ID parent, float dx = 0, float dy = 0)
+        {
+            auto ptr = new Velocity(parent, dx, dy);
+            Events::Dispatcher::raise<Events::ComponentCreated>(ptr);
+            return ptr;
+        }
+    };
+
+    // Stands in for components like Camera that own an OGRE object. The
+    // object is claimed by name from a table that, like OGRE's scene
+    // manager, refuses a name that's already taken
+    struct Resource : Components::Specific<Resource>
+    {
+        std::string name;
+        float value;
+
+        Resource(Entity::ID parent, float value_ = 0) :
+            Specific(parent), name(makeUniqueName("Resource")), value(value_)
+        {
+            if (!getClaimed().insert(name).second)
+            {
+                throw Exceptions::Exception("resource \"" + name + "\" already exists");
+            }
+        }
+
+        ~Resource() override
+        {
+            getClaimed().erase(name);
+        }
+
+        static Resource *create(Entity::ID parent, float value = 0)
+        {
+            auto ptr = new Resource(parent, value);
+            Events::Dispatcher::raise<Events::ComponentCreated>(ptr);
+            return ptr;
+        }
+
+        static std::set<std::string> &getClaimed()
+        {
+            static std::set<std::string> claimed;
+            return claimed;
+        }
+    };
+}
+
+template <>
+struct SnapshotTraits<Test::Position>
+{
+    static constexpr std::uint32_t VERSION = 1;
+
+    static void save(const Test::Position &position, SnapshotWriter &out)
+    {
+        out.write(position.x);
+        out.write(position.y);
+    }
+
+    static Test::Position *load(Entity::ID parent, SnapshotReader &in)
+    {
+        auto x = in.read<float>();
+        auto y = in.read<float>();
+        return new Test::Position(parent, x, y);
+    }
+};
+
+template <>
+struct SnapshotTraits<Test::Velocity>
+{
+    static constexpr std::uint32_t VERSION = 1;
+
+    // For checking what happens when a component fails to load
+    static inline bool failLoads = false;
+
+    static void save(const Test::Velocity &velocity, SnapshotWriter &out)
+    {
+        out.write(velocity.dx);
+        out.write(velocity.dy);
+    }
+
+    static Test::Velocity *load(Entity::ID parent, SnapshotReader &in)
+    {
+        auto dx = in.read<float>();
+        auto dy = in.read<float>();
+        if (failLoads)
+        {
+            throw Exceptions::BadSnapshot("test", "velocity failed to load");
+        }
+        return new Test::Velocity(parent, dx, dy);
+    }
+};
+
+template <>
+struct SnapshotTraits<Test::Resource>
+{
+    static constexpr std::uint32_t VERSION = 1;
+
+    static void save(const Test::Resource &resource, SnapshotWriter &out)
+    {
+        out.write(resource.value);
+    }
+
+    static Test::Resource *load(Entity::ID parent, SnapshotReader &in)
+    {
+        return new Test::Resource(parent, in.read<float>());
+    }
+};
+
+#define CHECK(condition)                                                   \
+    do                                                                     \
+    {                                                                      \
+        if (!(condition))                                                  \
+        {                                                                  \
+            std::cerr << __FILE__ << ":" << __LINE__                       \
+                      << ": check failed: " #condition << std::endl;       \
+            Test::getFailures()++;                                         \
+        }                                                                  \
+    } while (0)
+
+#define CHECK_THROWS(expression, exception)                                \
+    do                                                                     \
+    {                                                                      \
+        bool thrown = false;                                               \
+        try { expression; }                                                \
+        catch (const exception &) { thrown = true; }                       \
+        if (!thrown)                                                       \
+        {                                                                  \
+            std::cerr << __FILE__ << ":" << __LINE__                       \
+                      << ": expected " #exception " from " #expression     \
+                      << std::endl;                                        \
+            Test::getFailures()++;                                         \
+        }                                                                  \
+    } while (0)
+
+#endif